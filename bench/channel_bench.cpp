@@ -0,0 +1,218 @@
+/*
+ * 有界通道吞吐: PtSpscChannel/PtMpmcChannel
+ * producers个任务不停发送, consumers个任务不停接收, 每个样本是收到kItemsPerSample个数据的耗时, 单位ns/item
+ * capacity为1时每个数据都要在满/空之间交替: 生产者挂在slots_上, 消费者挂在items_上, 由对端唤醒(ping-pong)
+ * hold: 第c个消费者认领槽位后先yield c次再Release, 后认领的槽位可能先还回去,
+ *       生产者拿到空位计数时队尾槽位还被前一圈的消费者占着, 走ClaimSend返回nullptr后重新轮询的路径
+ * 默认单线程; 加-DPT_EXTEND_WORK_STEALING=1时在kWorkers个worker上运行, MPMC两端真正并发
+ * g++ -std=c++20 -O2 -I.. channel_bench.cpp ../pt_extend2.cpp -o channel_bench -pthread
+ * g++ -std=c++20 -O2 -I.. -DPT_EXTEND_WORK_STEALING=1 channel_bench.cpp ../pt_extend2.cpp -o channel_bench_ws -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include "pt_channel.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static constexpr uint32_t kItemsPerSample = 1u << 16;
+static constexpr uint32_t kSamples = 50;
+static constexpr uint32_t kWarmupSamples = 5;
+static constexpr uint32_t kMaxEndpoints = 8;
+#if PT_EXTEND_WORK_STEALING
+static constexpr uint32_t kWorkers = 4;
+#endif
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint64_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / static_cast<double>(ops));
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* name, uint32_t capacity, uint32_t producers, uint32_t consumers, bool hold) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-5s %8u %4u %4u %4s %5zu %8.2f %8.2f %8.2f %8.2f\n",
+        name, capacity, producers, consumers, hold ? "yes" : "no", sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99));
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+static constexpr uint32_t kPoison = UINT32_MAX;
+
+template<class Channel>
+struct Endpoint {
+    Channel* channel_;
+    typename Channel::Slot* slot_;
+    uint32_t value_;
+    uint32_t hold_; /* Release前yield的次数 */
+    uint32_t yields_;
+    std::atomic<uint64_t> received_; /* 只有自己写, 驱动任务读 */
+};
+
+static std::atomic<bool> stop;
+static std::atomic<uint32_t> exited;
+
+template<class Channel>
+static void Producer(void* userData) {
+    auto& self = *static_cast<Endpoint<Channel>*>(userData);
+    pt_extend_begin();
+    while (!stop.load(std::memory_order_relaxed)) {
+        pt_channel_send(*self.channel_, self.slot_, self.value_++ & 0x7fffffffu);
+    }
+    exited.fetch_add(1);
+    pt_extend_end();
+}
+
+template<class Channel>
+static void Consumer(void* userData) {
+    auto& self = *static_cast<Endpoint<Channel>*>(userData);
+    pt_extend_begin();
+    for (;;) {
+        pt_channel_acquire(*self.channel_, self.slot_);
+        self.value_ = self.slot_->value_;
+        for (self.yields_ = 0; self.yields_ < self.hold_; self.yields_++) {
+            pt_extend_yeild();
+        }
+        self.channel_->Release(self.slot_);
+        if (self.value_ == kPoison) {
+            break;
+        }
+        self.received_.store(self.received_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    exited.fetch_add(1);
+    pt_extend_end();
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+struct Scenario {
+    const char* name_;
+    uint32_t capacity_;
+    uint32_t producers_;
+    uint32_t consumers_;
+    bool hold_;
+    void (*run_)(void*);
+};
+
+template<class Channel>
+struct Bench {
+    static inline Channel channel;
+    static inline Endpoint<Channel> producers[kMaxEndpoints];
+    static inline Endpoint<Channel> consumers[kMaxEndpoints];
+    static inline typename Channel::Slot* slot;
+    static inline uint32_t i;
+    static inline uint32_t sample;
+    static inline uint64_t begin;
+
+    static uint64_t Received(const Scenario& scenario) {
+        uint64_t sum = 0;
+        for (uint32_t c = 0; c < scenario.consumers_; c++) {
+            sum += consumers[c].received_.load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    static void Start(const Scenario& scenario) {
+        stop = false;
+        exited = 0;
+        for (uint32_t p = 0; p < scenario.producers_; p++) {
+            producers[p].channel_ = &channel;
+            producers[p].value_ = 0;
+            pt_extend::AddDynamicTask("producer", Producer<Channel>, &producers[p]);
+        }
+        for (uint32_t c = 0; c < scenario.consumers_; c++) {
+            consumers[c].channel_ = &channel;
+            consumers[c].hold_ = scenario.hold_ ? c : 0;
+            consumers[c].received_.store(0, std::memory_order_relaxed);
+            pt_extend::AddDynamicTask("consumer", Consumer<Channel>, &consumers[c]);
+        }
+    }
+
+    /* 由驱动任务pt_extend_call, 返回时所有生产者/消费者都已退出 */
+    static void Run(void* userData) {
+        auto& scenario = *static_cast<const Scenario*>(userData);
+        pt_extend_begin();
+        Start(scenario);
+        for (sample = 0; sample < kSamples; sample++) {
+            begin = Received(scenario);
+            SampleBegin();
+            pt_extend_wait(Received(scenario) >= begin + kItemsPerSample);
+            SampleEnd(Received(scenario) - begin);
+        }
+
+        /* 生产者先退出, 再给每个消费者发一个kPoison */
+        stop = true;
+        pt_extend_wait(exited.load() == scenario.producers_);
+        for (i = 0; i < scenario.consumers_; i++) {
+            pt_channel_send(channel, slot, kPoison);
+        }
+        pt_extend_wait(exited.load() == scenario.producers_ + scenario.consumers_);
+        pt_extend_end();
+    }
+};
+
+static const Scenario kScenarios[] = {
+    {"spsc", 256, 1, 1, false, Bench<pt_extend::PtSpscChannel<uint32_t, 256>>::Run},
+    {"spsc", 1, 1, 1, false, Bench<pt_extend::PtSpscChannel<uint32_t, 1>>::Run},
+    {"mpmc", 256, 1, 1, false, Bench<pt_extend::PtMpmcChannel<uint32_t, 256>>::Run},
+    {"mpmc", 256, 4, 4, false, Bench<pt_extend::PtMpmcChannel<uint32_t, 256>>::Run},
+    {"mpmc", 1, 4, 4, false, Bench<pt_extend::PtMpmcChannel<uint32_t, 1>>::Run},
+    {"mpmc", 64, 4, 4, true, Bench<pt_extend::PtMpmcChannel<uint32_t, 64>>::Run},
+};
+
+static void Driver(void*) {
+    static uint32_t scenario;
+
+    pt_extend_begin();
+    std::printf("%-5s %8s %4s %4s %4s %5s %8s %8s %8s %8s  (ns/item)\n",
+        "chan", "capacity", "prod", "cons", "hold", "n", "mean", "p50", "p90", "p99");
+
+    for (scenario = 0; scenario < std::size(kScenarios); scenario++) {
+        pt_extend_call(kScenarios[scenario].run_, const_cast<Scenario*>(&kScenarios[scenario]));
+        Report(kScenarios[scenario].name_, kScenarios[scenario].capacity_,
+            kScenarios[scenario].producers_, kScenarios[scenario].consumers_, kScenarios[scenario].hold_);
+    }
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+    pt_extend::AddDynamicTask("driver", Driver);
+#if PT_EXTEND_WORK_STEALING
+    pt_extend::RunSchedulerWorkStealing(kWorkers);
+#else
+    pt_extend::RunSchedulerNoPriority();
+#endif
+}
@@ -0,0 +1,246 @@
+/*
+ * 宏任务和C++20协程任务的对比基准, 同一个调度器
+ * yield往返(64个任务) / 嵌套调用(pt_extend_call对co_await CoTask) / 事件乒乓
+ * 每个样本是一批操作的平均耗时, 输出样本的均值和分位数, 单位ns/op
+ * g++ -std=c++20 -O2 -I.. coroutine_bench.cpp ../pt_extend2.cpp -o coroutine_bench -pthread
+*/
+
+#include "pt_coroutine.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+#if PT_EXTEND_WORK_STEALING
+#error "build coroutine_bench without work stealing"
+#endif
+
+static constexpr uint32_t kYieldTasks = 64;
+static constexpr uint32_t kYieldSamples = 20'000;
+static constexpr uint32_t kNestDepths[] = {1, 4, 16};
+static constexpr uint32_t kNestCallsPerSample = 1000;
+static constexpr uint32_t kNestSamples = 2000;
+static constexpr uint32_t kPingPongPerSample = 1000;
+static constexpr uint32_t kPingPongSamples = 1000;
+static constexpr uint32_t kWarmupSamples = 10;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint32_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / ops);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* frontEnd, const char* scenario, uint32_t param) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-9s %-14s %6u %6zu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+        frontEnd, scenario, param, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), sorted.back());
+}
+
+// --------------------------------------------------------------------------------
+// Macro
+// --------------------------------------------------------------------------------
+static bool yieldStop;
+static uint32_t yieldExited;
+static void MacroYielder(void*) {
+    pt_extend_begin();
+    while (!yieldStop) {
+        pt_extend_yeild();
+    }
+    ++yieldExited;
+    pt_extend_end();
+}
+
+static uint32_t nestDepth;
+static void MacroNest(void*) {
+    pt_extend_begin();
+    if (pt_extend::nestingLevel < nestDepth) {
+        pt_extend_call(MacroNest, nullptr);
+    }
+    pt_extend_end();
+}
+
+static bool pongStop;
+static bool pongExited;
+static pt_extend::PtEvent pingEvent;
+static pt_extend::PtEvent pongEvent;
+static void MacroPonger(void*) {
+    pt_extend_begin();
+    for (;;) {
+        pt_event_take(pingEvent);
+        if (pongStop) {
+            break;
+        }
+        pongEvent.Give();
+    }
+    pongExited = true;
+    pt_extend_end();
+}
+
+// --------------------------------------------------------------------------------
+// Coroutine
+// --------------------------------------------------------------------------------
+static pt_extend::CoTask<> CoYielder() {
+    while (!yieldStop) {
+        co_await pt_extend::CoYield{};
+    }
+    ++yieldExited;
+}
+
+static pt_extend::CoTask<uint32_t> CoNest(uint32_t level) {
+    if (level < nestDepth) {
+        co_return co_await CoNest(level + 1) + 1;
+    }
+    co_return 1;
+}
+
+static pt_extend::CoTask<> CoPonger() {
+    for (;;) {
+        co_await pt_extend::CoTake{pingEvent};
+        if (pongStop) {
+            break;
+        }
+        pongEvent.Give();
+    }
+    pongExited = true;
+}
+
+/* 协程版的嵌套和乒乓测量本身也要在协程里 */
+static bool coDriverDone;
+static pt_extend::CoTask<> CoDriver() {
+    uint32_t sink = 0;
+    for (uint32_t depth : kNestDepths) {
+        nestDepth = depth;
+        for (uint32_t sample = 0; sample < kNestSamples; sample++) {
+            SampleBegin();
+            for (uint32_t i = 0; i < kNestCallsPerSample; i++) {
+                sink += co_await CoNest(1);
+            }
+            SampleEnd(kNestCallsPerSample);
+        }
+        Report("coroutine", "call-nest", depth);
+    }
+    if (sink == 0) {
+        std::abort();
+    }
+
+    pongStop = false;
+    pongExited = false;
+    pt_extend::AddCoroutineTask("co-ponger", CoPonger());
+    for (uint32_t sample = 0; sample < kPingPongSamples; sample++) {
+        SampleBegin();
+        for (uint32_t i = 0; i < kPingPongPerSample; i++) {
+            pingEvent.Give();
+            co_await pt_extend::CoTake{pongEvent};
+        }
+        SampleEnd(kPingPongPerSample);
+    }
+    Report("coroutine", "event-pingpong", 1);
+    pongStop = true;
+    pingEvent.Give();
+    while (!pongExited) {
+        co_await pt_extend::CoYield{};
+    }
+    coDriverDone = true;
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+static void Driver(void*) {
+    static uint32_t sample;
+    static uint32_t i;
+    static uint32_t scenario;
+
+    pt_extend_begin();
+    std::printf("%-9s %-14s %6s %6s %9s %9s %9s %9s %9s  (ns/op)\n",
+        "front", "scenario", "param", "n", "mean", "p50", "p90", "p99", "max");
+
+    /* yield往返: 每个样本是驱动任务两次运行之间的一轮, 除以本轮运行的任务数 */
+    for (scenario = 0; scenario < 2; scenario++) {
+        yieldStop = false;
+        yieldExited = 0;
+        for (i = 0; i < kYieldTasks; i++) {
+            if (scenario == 0) {
+                pt_extend::AddDynamicTask("yielder", MacroYielder);
+            } else {
+                pt_extend::AddCoroutineTask("co-yielder", CoYielder());
+            }
+        }
+        pt_extend_yeild();
+        for (sample = 0; sample < kYieldSamples; sample++) {
+            SampleBegin();
+            pt_extend_yeild();
+            SampleEnd(kYieldTasks + 1);
+        }
+        Report(scenario == 0 ? "macro" : "coroutine", "yield", kYieldTasks);
+        yieldStop = true;
+        pt_extend_wait(yieldExited == kYieldTasks);
+    }
+
+    for (scenario = 0; scenario < std::size(kNestDepths); scenario++) {
+        nestDepth = kNestDepths[scenario];
+        for (sample = 0; sample < kNestSamples; sample++) {
+            SampleBegin();
+            for (i = 0; i < kNestCallsPerSample; i++) {
+                pt_extend_call(MacroNest, nullptr);
+            }
+            SampleEnd(kNestCallsPerSample);
+        }
+        Report("macro", "call-nest", kNestDepths[scenario]);
+    }
+
+    pongStop = false;
+    pongExited = false;
+    pt_extend::AddDynamicTask("ponger", MacroPonger);
+    for (sample = 0; sample < kPingPongSamples; sample++) {
+        SampleBegin();
+        for (i = 0; i < kPingPongPerSample; i++) {
+            pingEvent.Give();
+            pt_event_take(pongEvent);
+        }
+        SampleEnd(kPingPongPerSample);
+    }
+    Report("macro", "event-pingpong", 1);
+    pongStop = true;
+    pingEvent.Give();
+    pt_extend_wait(pongExited);
+
+    pt_extend::AddCoroutineTask("co-driver", CoDriver());
+    pt_extend_wait(coDriverDone);
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+    pt_extend::AddDynamicTask("driver", Driver, kNestDepths[std::size(kNestDepths) - 1]);
+    pt_extend::RunSchedulerNoPriority();
+}
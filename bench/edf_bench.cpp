@@ -0,0 +1,164 @@
+/*
+ * 控制任务在大量批处理任务之间的唤醒延迟: FIFO就绪队列 对比 EDF
+ * bulk个批处理任务每次运行忙等work微秒后yield, 另一个线程每period微秒GiveFromISR一次唤醒控制任务
+ * 延迟是Give到控制任务开始运行的时间, 单位us; EDF版本的控制任务截止时间是200us
+ * g++ -std=c++20 -O2 -I.. edf_bench.cpp ../pt_extend2.cpp -o edf_bench_fifo -pthread
+ * g++ -std=c++20 -O2 -I.. -DPT_EXTEND_ENABLE_EDF=1 edf_bench.cpp ../pt_extend2.cpp -o edf_bench -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#if PT_EXTEND_WORK_STEALING
+#error "build edf_bench without work stealing"
+#endif
+
+static constexpr uint32_t kSamples = 2000;
+static constexpr uint32_t kWarmupSamples = 20;
+static constexpr uint32_t kPeriodUs = 1000;
+static constexpr uint32_t kDeadlineUs = 200;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* mode, uint32_t bulk, uint32_t workUs, uint32_t misses) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-5s %5u %5u %6zu %8.1f %8.1f %8.1f %8.1f %8.1f %7u\n",
+        mode, bulk, workUs, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), sorted.back(), misses);
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+static pt_extend::PtEvent tick;
+static std::atomic<int64_t> givenAt;
+static std::atomic<bool> ticking;
+static bool stop;
+static uint32_t exited;
+static uint32_t workUs;
+static uint32_t misses;
+
+static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(BenchClock::now().time_since_epoch()).count();
+}
+
+static void Spin(uint32_t us) {
+    auto end = BenchClock::now() + std::chrono::microseconds(us);
+    while (BenchClock::now() < end) {
+    }
+}
+
+static void Bulk(void*) {
+    pt_extend_begin();
+    while (!stop) {
+        Spin(workUs);
+        pt_extend_yeild();
+    }
+    ++exited;
+    pt_extend_end();
+}
+
+static void Ticker() {
+    while (ticking.load(std::memory_order_relaxed)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(kPeriodUs));
+        givenAt.store(NowNs(), std::memory_order_relaxed);
+        tick.GiveFromISR();
+    }
+}
+
+static void Control(void*) {
+    static uint32_t sample;
+
+    pt_extend_begin();
+    for (sample = 0; sample < kSamples; sample++) {
+        pt_event_take(tick);
+        samples.push_back(static_cast<double>(NowNs() - givenAt.load(std::memory_order_relaxed)) / 1000.0);
+    }
+#if PT_EXTEND_ENABLE_EDF
+    /* 动态任务结束后TCB就释放了 */
+    misses = pt_extend::GetDeadlineMisses(*pt_extend::GetCurrentTask());
+#endif
+    ++exited;
+    pt_extend_end();
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+struct Scenario {
+    uint32_t bulk_;
+    uint32_t workUs_;
+};
+
+static const Scenario kScenarios[] = {
+    {0, 0},
+    {16, 5},
+    {64, 5},
+    {16, 50},
+};
+
+static void Driver(void*) {
+    static uint32_t scenario;
+    static uint32_t i;
+    static std::thread ticker;
+
+    pt_extend_begin();
+    std::printf("%-5s %5s %5s %6s %8s %8s %8s %8s %8s %7s  (us)\n",
+        "mode", "bulk", "work", "n", "mean", "p50", "p90", "p99", "max", "misses");
+
+    for (scenario = 0; scenario < std::size(kScenarios); scenario++) {
+        stop = false;
+        exited = 0;
+        workUs = kScenarios[scenario].workUs_;
+        for (i = 0; i < kScenarios[scenario].bulk_; i++) {
+            pt_extend::AddDynamicTask("bulk", Bulk);
+        }
+#if PT_EXTEND_ENABLE_EDF
+        pt_extend::SetTaskDeadline(*pt_extend::AddDynamicTask("control", Control), kDeadlineUs);
+#else
+        pt_extend::AddDynamicTask("control", Control);
+#endif
+        tick.count_.store(0);
+        ticking = true;
+        ticker = std::thread(Ticker);
+        pt_extend_wait(exited == 1);
+        ticking = false;
+        ticker.join();
+        stop = true;
+        pt_extend_wait(exited == kScenarios[scenario].bulk_ + 1);
+
+        Report(PT_EXTEND_ENABLE_EDF ? "edf" : "fifo", kScenarios[scenario].bulk_, workUs, misses);
+    }
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+    pt_extend::AddDynamicTask("driver", Driver);
+    pt_extend::RunSchedulerNoPriority();
+}
@@ -0,0 +1,178 @@
+/*
+ * 异步I/O基准: 1/64/1024个任务并发对一个文件做4KB随机pread
+ * 对比调度器线程上直接同步pread, 每个样本是一批读的平均耗时, 单位ns/op
+ * 一轮里各任务的提交合并成一次io_uring_enter, 并发越高每次系统调用分摊的操作越多
+ * g++ -std=c++20 -O2 -DPT_EXTEND_IO_URING=1 -I.. io_bench.cpp ../pt_extend2.cpp -o io_bench -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if !PT_EXTEND_IO_URING
+#error "build io_bench with -DPT_EXTEND_IO_URING=1"
+#endif
+
+static constexpr uint32_t kConcurrency[] = {1, 64, 1024};
+static constexpr uint32_t kBlockSize = 4096;
+static constexpr uint32_t kFileBlocks = 4096; /* 16MB, 在页缓存里 */
+static constexpr uint32_t kReadsPerSample = 4096;
+static constexpr uint32_t kSamples = 200;
+static constexpr uint32_t kWarmupSamples = 10;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint32_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / ops);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* mode, uint32_t param) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-8s %6u %6zu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+        mode, param, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), sorted.back());
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+static int fileFd;
+static uint32_t readsLeft;  /* 本样本还要发出的读 */
+static uint32_t readsDone;
+static uint32_t readerCount;
+static bool readerStop;
+static uint32_t readersExited;
+
+static int64_t RandomOffset(uint32_t& seed) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return static_cast<int64_t>(seed % kFileBlocks) * kBlockSize;
+}
+
+struct Reader {
+    pt_extend::PtIo io_;
+    uint32_t seed_;
+    alignas(64) char buf_[kBlockSize];
+};
+
+static void ReaderTask(void* userData) {
+    auto& self = *static_cast<Reader*>(userData);
+    pt_extend_begin();
+    while (!readerStop) {
+        pt_extend_wait(readsLeft != 0 || readerStop);
+        if (readerStop) {
+            break;
+        }
+        --readsLeft;
+        pt_io_read(self.io_, fileFd, self.buf_, kBlockSize, RandomOffset(self.seed_));
+        if (self.io_.result_ != static_cast<int32_t>(kBlockSize)) {
+            std::printf("read failed: %d\n", self.io_.result_);
+            std::exit(1);
+        }
+        ++readsDone;
+    }
+    ++readersExited;
+    pt_extend_end();
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+static void Driver(void*) {
+    static uint32_t scenario;
+    static uint32_t sample;
+    static std::vector<Reader> readers;
+
+    pt_extend_begin();
+    std::printf("%-8s %6s %6s %9s %9s %9s %9s %9s  (ns/read)\n",
+        "mode", "tasks", "n", "mean", "p50", "p90", "p99", "max");
+
+    /* 基准线: 调度器线程上同步pread */
+    {
+        uint32_t seed = 1;
+        static char buf[kBlockSize];
+        for (uint32_t s = 0; s < kSamples; s++) {
+            SampleBegin();
+            for (uint32_t i = 0; i < kReadsPerSample; i++) {
+                if (pread(fileFd, buf, kBlockSize, RandomOffset(seed)) != static_cast<ssize_t>(kBlockSize)) {
+                    std::exit(1);
+                }
+            }
+            SampleEnd(kReadsPerSample);
+        }
+        Report("pread", 1);
+    }
+
+    for (scenario = 0; scenario < std::size(kConcurrency); scenario++) {
+        readerCount = kConcurrency[scenario];
+        readerStop = false;
+        readersExited = 0;
+        readers = std::vector<Reader>(readerCount);
+        for (uint32_t i = 0; i < readerCount; i++) {
+            readers[i].seed_ = i * 2654435761u + 1;
+            pt_extend::AddDynamicTask("reader", ReaderTask, &readers[i]);
+        }
+
+        for (sample = 0; sample < kSamples; sample++) {
+            readsDone = 0;
+            readsLeft = kReadsPerSample;
+            SampleBegin();
+            pt_extend_wait(readsDone == kReadsPerSample);
+            SampleEnd(kReadsPerSample);
+        }
+        Report("pt_io", readerCount);
+
+        readerStop = true;
+        pt_extend_wait(readersExited == readerCount);
+    }
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+    char path[] = "/tmp/io_benchXXXXXX";
+    fileFd = mkstemp(path);
+    unlink(path);
+    std::vector<char> block(kBlockSize, 'x');
+    for (uint32_t i = 0; i < kFileBlocks; i++) {
+        if (write(fileFd, block.data(), kBlockSize) != static_cast<ssize_t>(kBlockSize)) {
+            return 1;
+        }
+    }
+
+    pt_extend::AddDynamicTask("driver", Driver);
+    pt_extend::RunSchedulerNoPriority();
+}
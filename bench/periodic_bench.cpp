@@ -0,0 +1,183 @@
+/*
+ * 周期任务的漂移: pt_extend_delay 对比 pt_extend_delay_until
+ * 周期任务每period毫秒运行一次, 每次工作work微秒(忙等, yield列为1时改为反复yield直到经过work微秒);
+ * busy个干扰任务每次运行忙等spin微秒后yield
+ * drift是kPeriods个周期实际耗时减去理想耗时, 单位ms; 样本是每次醒来相对理想时刻的偏差, 单位us
+ * until模式检查每次延时后lastWake仍在周期网格上, 且按实际经过的时间算落后调用时刻不到一个周期, 否则记入offgrid并以1退出
+ * g++ -std=c++20 -O2 -I.. periodic_bench.cpp ../pt_extend2.cpp -o periodic_bench -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if PT_EXTEND_WORK_STEALING
+#error "build periodic_bench without work stealing"
+#endif
+#if !PT_EXTEND_TICKLESS_IDLE
+#error "build periodic_bench with tickless idle"
+#endif
+
+static constexpr uint32_t kPeriods = 200;
+static constexpr uint32_t kPeriodMs = 5;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 输出并清空 */
+static void Report(const char* mode, uint32_t busy, uint32_t spinUs, uint32_t workUs, bool yieldWork,
+    double driftMs, uint32_t overruns, uint32_t offGrid) {
+    std::vector<double> sorted = std::move(samples);
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    std::printf("%-6s %5u %5u %5u %5u %9.2f %8.1f %8.1f %8.1f %9u %7u\n",
+        mode, busy, spinUs, workUs, yieldWork ? 1u : 0u, driftMs,
+        Percentile(sorted, 0.5), Percentile(sorted, 0.99), sorted.back(), overruns, offGrid);
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+static bool stop;
+static uint32_t exited;
+static uint32_t spinUs;
+static uint32_t workUs;
+static bool yieldWork;
+static bool useUntil;
+static double driftMs;
+static uint32_t overruns;
+static uint32_t offGrid;
+static uint32_t totalOffGrid;
+
+static void Spin(uint32_t us) {
+    auto end = BenchClock::now() + std::chrono::microseconds(us);
+    while (BenchClock::now() < end) {
+    }
+}
+
+static void Busy(void*) {
+    pt_extend_begin();
+    while (!stop) {
+        Spin(spinUs);
+        pt_extend_yeild();
+    }
+    ++exited;
+    pt_extend_end();
+}
+
+static void Periodic(void*) {
+    static BenchClock::time_point begin;
+    static BenchClock::time_point workEnd;
+    static uint64_t firstWake;
+    static uint64_t lastWake;
+    static uint64_t callTicks; /* 按实际时间算, 调用时从begin经过的tick数 */
+    static uint32_t period;
+
+    pt_extend_begin();
+    begin = BenchClock::now();
+    firstWake = lastWake = pt_extend::GetTickCount();
+    offGrid = 0;
+    for (period = 0; period < kPeriods; period++) {
+        if (yieldWork) {
+            workEnd = BenchClock::now() + std::chrono::microseconds(workUs);
+            while (BenchClock::now() < workEnd) {
+                pt_extend_yeild();
+            }
+        } else {
+            Spin(workUs);
+        }
+        if (useUntil) {
+            callTicks = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                BenchClock::now() - begin).count()) / pt_extend::tickResolutionUs;
+            pt_extend_delay_until(lastWake, kPeriodMs);
+            uint64_t periodTicks = static_cast<uint64_t>(pt_extend::Ms2Ticks(kPeriodMs));
+            /* firstWake和begin之间最多差一个tick */
+            if ((lastWake - firstWake) % periodTicks != 0 || lastWake - firstWake + periodTicks + 1 <= callTicks) {
+                ++offGrid;
+            }
+        } else {
+            pt_extend_delay(kPeriodMs);
+        }
+        auto ideal = begin + std::chrono::milliseconds(kPeriodMs) * (period + 1);
+        samples.push_back(std::chrono::duration<double, std::micro>(BenchClock::now() - ideal).count());
+    }
+    driftMs = std::chrono::duration<double, std::milli>(BenchClock::now() - begin).count() - kPeriods * kPeriodMs;
+    /* 动态任务结束后TCB就释放了 */
+    overruns = pt_extend::GetPeriodOverruns(*pt_extend::GetCurrentTask());
+    ++exited;
+    pt_extend_end();
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+struct Scenario {
+    uint32_t busy_;
+    uint32_t spinUs_;
+    uint32_t workUs_;
+    bool yieldWork_;
+};
+
+static const Scenario kScenarios[] = {
+    {0, 0, 500, false},
+    {4, 300, 500, false},
+    {4, 300, 2000, false},
+    {8, 500, 500, false},
+    /* 工作期间yield, 时间轮为空时tick也要继续计数 */
+    {0, 0, 2000, true},
+    {0, 0, 12000, true},
+    {4, 300, 2000, true},
+};
+
+static void Driver(void*) {
+    static uint32_t scenario;
+    static uint32_t mode;
+    static uint32_t i;
+
+    pt_extend_begin();
+    std::printf("%-6s %5s %5s %5s %5s %9s %8s %8s %8s %9s %7s  (late us)\n",
+        "mode", "busy", "spin", "work", "yield", "drift(ms)", "p50", "p99", "max", "overruns", "offgrid");
+
+    for (scenario = 0; scenario < std::size(kScenarios); scenario++) {
+        for (mode = 0; mode < 2; mode++) {
+            stop = false;
+            exited = 0;
+            spinUs = kScenarios[scenario].spinUs_;
+            workUs = kScenarios[scenario].workUs_;
+            yieldWork = kScenarios[scenario].yieldWork_;
+            useUntil = mode == 1;
+            for (i = 0; i < kScenarios[scenario].busy_; i++) {
+                pt_extend::AddDynamicTask("busy", Busy);
+            }
+            pt_extend::AddDynamicTask("periodic", Periodic);
+            pt_extend_wait(exited == 1);
+            stop = true;
+            pt_extend_wait(exited == kScenarios[scenario].busy_ + 1);
+
+            Report(useUntil ? "until" : "delay", kScenarios[scenario].busy_, spinUs, workUs, yieldWork,
+                driftMs, overruns, offGrid);
+            totalOffGrid += offGrid;
+        }
+    }
+
+    std::exit(totalOffGrid == 0 ? 0 : 1);
+    pt_extend_end();
+}
+
+int main() {
+    pt_extend::AddDynamicTask("driver", Driver);
+    pt_extend::RunSchedulerNoPriority();
+}
@@ -0,0 +1,312 @@
+/*
+ * 调度器热路径基准, 同一份代码分别对pt_extend和pt_extend2编译
+ * yield往返 / 嵌套调用(按深度) / 动态任务创建+结束 / 延时到期(1k/100k/1M个睡眠任务) / 事件乒乓
+ * 每个样本是一批操作的平均耗时, 输出样本的均值和分位数, 单位ns/op
+ * pt_extend没有嵌套调用和PtEvent: 嵌套输出n/a, 乒乓用pt_extend_wait等待计数代替
+ * 延时由基准自己调用TimerTick驱动, pt_extend2需要关闭无tick空闲以免真实时钟混入
+ * g++ -std=c++20 -O2 -DPT_BENCH_V1 -I.. pt_bench.cpp ../pt_extend.cpp -o pt_bench_v1
+ * g++ -std=c++20 -O2 -DPT_EXTEND_TICKLESS_IDLE=0 -I.. pt_bench.cpp ../pt_extend2.cpp -o pt_bench_v2 -pthread
+*/
+
+#ifdef PT_BENCH_V1
+#include "pt_extend.hpp"
+#else
+#include "pt_extend2.hpp"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <vector>
+
+#ifdef PT_BENCH_V1
+static constexpr const char* kRuntime = "pt_extend";
+#else
+static constexpr const char* kRuntime = "pt_extend2";
+#if PT_EXTEND_TICKLESS_IDLE || PT_EXTEND_WORK_STEALING
+#error "build pt_bench with -DPT_EXTEND_TICKLESS_IDLE=0 and without work stealing"
+#endif
+#endif
+
+static constexpr uint32_t kYieldTasks[] = {1, 64, 4096};
+static constexpr uint32_t kYieldResumes = 4'000'000;
+static constexpr uint32_t kNestDepths[] = {1, 4, 16, 64};
+static constexpr uint32_t kNestCallsPerSample = 1000;
+static constexpr uint32_t kNestSamples = 2000;
+static constexpr uint32_t kSpawnBatch = 1000;
+static constexpr uint32_t kSpawnSamples = 2000;
+static constexpr uint32_t kSleepers[] = {1'000, 100'000, 1'000'000};
+static constexpr uint32_t kSleepRounds[] = {200, 20, 5};
+static constexpr int32_t kSleepPeriodMs = 1000;
+static constexpr uint32_t kPingPongPerSample = 1000;
+static constexpr uint32_t kPingPongSamples = 1000;
+static constexpr uint32_t kWarmupSamples = 10;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint32_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / ops);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本(样本足够多时)后输出并清空 */
+static void Report(const char* scenario, uint32_t param) {
+    auto first = samples.begin();
+    if (samples.size() > kWarmupSamples * 4) {
+        first += kWarmupSamples;
+    }
+    std::vector<double> sorted(first, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-10s %-14s %8u %6zu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+        kRuntime, scenario, param, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), sorted.back());
+}
+
+#ifdef PT_BENCH_V1
+/* pt_extend没有的场景 */
+static void ReportNotAvailable(const char* scenario, uint32_t param) {
+    std::printf("%-10s %-14s %8u %6s %9s\n", kRuntime, scenario, param, "-", "n/a");
+}
+#endif
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+static void Spawn(const char* name, void(*code)(void*)) {
+#ifdef PT_BENCH_V1
+    pt_extend::AddDynamicTask(name, code, 0);
+#else
+    pt_extend::AddDynamicTask(name, code);
+#endif
+}
+
+/* yield往返 */
+static bool yieldStop;
+static uint32_t yieldExited;
+static void Yielder(void*) {
+    pt_extend_begin();
+    while (!yieldStop) {
+        pt_extend_yeild();
+    }
+    ++yieldExited;
+    pt_extend_end();
+}
+
+/* 创建后立即结束 */
+static void Child(void*) {
+    pt_extend_begin();
+    pt_extend_end();
+}
+
+/* 周期延时, 每次到期计数 */
+static bool sleepStop;
+static uint32_t sleepStarted;
+static uint32_t sleepWoken;
+static void Sleeper(void*) {
+    pt_extend_begin();
+    ++sleepStarted;
+    while (!sleepStop) {
+        pt_extend_delay(kSleepPeriodMs);
+        ++sleepWoken;
+    }
+    pt_extend_end();
+}
+
+/* 乒乓的应答方 */
+static bool pongStop;
+static bool pongExited;
+#ifdef PT_BENCH_V1
+static uint32_t pingCount;
+static uint32_t pongCount;
+static void Ponger(void*) {
+    pt_extend_begin();
+    for (;;) {
+        pt_extend_wait(pingCount != pongCount);
+        if (pongStop) {
+            break;
+        }
+        ++pongCount;
+    }
+    pongExited = true;
+    pt_extend_end();
+}
+#else
+static pt_extend::PtEvent pingEvent;
+static pt_extend::PtEvent pongEvent;
+static void Ponger(void*) {
+    pt_extend_begin();
+    for (;;) {
+        pt_event_take(pingEvent);
+        if (pongStop) {
+            break;
+        }
+        pongEvent.Give();
+    }
+    pongExited = true;
+    pt_extend_end();
+}
+
+/* 递归嵌套到nestDepth层 */
+static uint32_t nestDepth;
+static void Nest(void*) {
+    pt_extend_begin();
+    if (pt_extend::nestingLevel < nestDepth) {
+        pt_extend_call(Nest, nullptr);
+    }
+    pt_extend_end();
+}
+#endif
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+/* 按顺序运行全部场景, 局部状态都用静态变量 */
+static void Driver(void*) {
+    static uint32_t scenario;
+    static uint32_t sample;
+    static uint32_t sampleCount;
+    static uint32_t i;
+
+    pt_extend_begin();
+    std::printf("%-10s %-14s %8s %6s %9s %9s %9s %9s %9s  (ns/op)\n",
+        "runtime", "scenario", "param", "n", "mean", "p50", "p90", "p99", "max");
+
+    /* yield往返: 每个样本是驱动任务两次运行之间的一轮, 除以本轮运行的任务数 */
+    for (scenario = 0; scenario < std::size(kYieldTasks); scenario++) {
+        yieldStop = false;
+        yieldExited = 0;
+        for (i = 0; i < kYieldTasks[scenario]; i++) {
+            Spawn("yielder", Yielder);
+        }
+        pt_extend_yeild();
+
+        sampleCount = kYieldResumes / (kYieldTasks[scenario] + 1);
+        for (sample = 0; sample < sampleCount; sample++) {
+            SampleBegin();
+            pt_extend_yeild();
+            SampleEnd(kYieldTasks[scenario] + 1);
+        }
+        Report("yield", kYieldTasks[scenario]);
+
+        yieldStop = true;
+        pt_extend_wait(yieldExited == kYieldTasks[scenario]);
+    }
+
+    /* 嵌套调用: 每次调用一直嵌套到目标深度再逐层返回 */
+    for (scenario = 0; scenario < std::size(kNestDepths); scenario++) {
+#ifdef PT_BENCH_V1
+        ReportNotAvailable("call-nest", kNestDepths[scenario]);
+#else
+        nestDepth = kNestDepths[scenario];
+        for (sample = 0; sample < kNestSamples; sample++) {
+            SampleBegin();
+            for (i = 0; i < kNestCallsPerSample; i++) {
+                pt_extend_call(Nest, nullptr);
+            }
+            SampleEnd(kNestCallsPerSample);
+        }
+        Report("call-nest", kNestDepths[scenario]);
+#endif
+    }
+
+    /* 创建+结束: 每个样本创建一批任务, 它们在下一轮运行并结束 */
+    for (sample = 0; sample < kSpawnSamples; sample++) {
+        SampleBegin();
+        for (i = 0; i < kSpawnBatch; i++) {
+            Spawn("child", Child);
+        }
+        pt_extend_yeild();
+        SampleEnd(kSpawnBatch);
+    }
+    pt_extend_yeild();
+    Report("spawn-exit", kSpawnBatch);
+
+    /* 延时到期: 所有睡眠任务同一tick到期, 计入到期/唤醒运行/重新插入 */
+    for (scenario = 0; scenario < std::size(kSleepers); scenario++) {
+        sleepStop = false;
+        sleepStarted = 0;
+        for (i = 0; i < kSleepers[scenario]; i++) {
+            Spawn("sleeper", Sleeper);
+        }
+        pt_extend_wait(sleepStarted == kSleepers[scenario]);
+
+        for (sample = 0; sample < kSleepRounds[scenario]; sample++) {
+            sleepWoken = 0;
+            SampleBegin();
+            pt_extend::TimerTick(pt_extend::Ms2Ticks(kSleepPeriodMs));
+            pt_extend_wait(sleepWoken == kSleepers[scenario]);
+            SampleEnd(kSleepers[scenario]);
+        }
+        Report("delay-expiry", kSleepers[scenario]);
+
+        sleepStop = true;
+        sleepWoken = 0;
+        pt_extend::TimerTick(pt_extend::Ms2Ticks(kSleepPeriodMs));
+        pt_extend_wait(sleepWoken == kSleepers[scenario]);
+    }
+
+    /* 乒乓: 一次往返是两次唤醒和两次切换 */
+    pongStop = false;
+    pongExited = false;
+    Spawn("ponger", Ponger);
+    for (sample = 0; sample < kPingPongSamples; sample++) {
+        SampleBegin();
+        for (i = 0; i < kPingPongPerSample; i++) {
+#ifdef PT_BENCH_V1
+            ++pingCount;
+            pt_extend_wait(pongCount == pingCount);
+#else
+            pingEvent.Give();
+            pt_event_take(pongEvent);
+#endif
+        }
+        SampleEnd(kPingPongPerSample);
+    }
+#ifdef PT_BENCH_V1
+    Report("wait-pingpong", 1);
+#else
+    Report("event-pingpong", 1);
+#endif
+    pongStop = true;
+#ifdef PT_BENCH_V1
+    ++pingCount;
+#else
+    pingEvent.Give();
+#endif
+    pt_extend_wait(pongExited);
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+#ifdef PT_BENCH_V1
+    pt_extend::AddDynamicTask("driver", Driver, 0);
+#else
+    pt_extend::AddDynamicTask("driver", Driver, kNestDepths[std::size(kNestDepths) - 1]);
+#endif
+    pt_extend::RunSchedulerNoPriority();
+}
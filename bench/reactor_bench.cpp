@@ -0,0 +1,205 @@
+/*
+ * fd等待基准: pt_extend_wait轮询非阻塞read 对比 epoll反应器
+ * 一对管道上的乒乓往返, 同时挂着0/100/1000个没有数据的空闲连接
+ * 轮询方式每轮都要对每个空闲连接read一次, 反应器只处理就绪的fd
+ * 每个样本是一批往返的平均耗时, 输出样本的均值和分位数, 单位ns/op
+ * g++ -std=c++20 -O2 -DPT_EXTEND_EPOLL_REACTOR=1 -I.. reactor_bench.cpp ../pt_extend2.cpp -o reactor_bench -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#if !PT_EXTEND_EPOLL_REACTOR || PT_EXTEND_WORK_STEALING
+#error "build reactor_bench with -DPT_EXTEND_EPOLL_REACTOR=1 and without work stealing"
+#endif
+
+static constexpr uint32_t kIdleConns[] = {0, 100, 1000};
+static constexpr uint32_t kPingPongPerSample = 100;
+static constexpr uint32_t kPingPongSamples = 500;
+static constexpr uint32_t kWarmupSamples = 10;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint32_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / ops);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* mode, uint32_t idle) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-8s %6u %6zu %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+        mode, idle, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), sorted.back());
+}
+
+// --------------------------------------------------------------------------------
+// Connection
+// --------------------------------------------------------------------------------
+struct Conn {
+    int readFd_;
+    int writeFd_;
+    pt_extend::PtFd* watch_; /* 反应器方式下读端的注册 */
+};
+
+static Conn OpenConn(bool reactor) {
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK) != 0) {
+        std::perror("pipe2");
+        std::exit(1);
+    }
+    Conn conn = {fds[0], fds[1], nullptr};
+    if (reactor) {
+        conn.watch_ = pt_extend::OpenFd(conn.readFd_);
+    }
+    return conn;
+}
+
+static bool TryRead(const Conn& conn) {
+    char byte;
+    return read(conn.readFd_, &byte, 1) == 1;
+}
+
+static void Send(const Conn& conn) {
+    char byte = 0;
+    if (write(conn.writeFd_, &byte, 1) != 1) {
+        std::perror("write");
+        std::exit(1);
+    }
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+static bool useReactor;
+static Conn ping;
+static Conn pong;
+
+/* 空闲连接上永远没有数据 */
+static void IdleConn(void* userData) {
+    auto& conn = *static_cast<Conn*>(userData);
+    pt_extend_begin();
+    for (;;) {
+        if (useReactor) {
+            /* 读到EAGAIN才等待 */
+            while (!TryRead(conn)) {
+                pt_fd_wait_readable(*conn.watch_);
+            }
+        } else {
+            pt_extend_wait(TryRead(conn));
+        }
+    }
+    pt_extend_end();
+}
+
+static void Ponger(void*) {
+    pt_extend_begin();
+    for (;;) {
+        if (useReactor) {
+            while (!TryRead(ping)) {
+                pt_fd_wait_readable(*ping.watch_);
+            }
+        } else {
+            pt_extend_wait(TryRead(ping));
+        }
+        Send(pong);
+    }
+    pt_extend_end();
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+/* 空闲任务不会退出, 所以每个场景单独一个进程 */
+static void Driver(void* userData) {
+    static uint32_t sample;
+    static uint32_t i;
+    uint32_t idle = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(userData));
+
+    pt_extend_begin();
+    for (i = 0; i < idle; i++) {
+        pt_extend::AddDynamicTask("idle", IdleConn, new Conn{OpenConn(useReactor)});
+    }
+    ping = OpenConn(useReactor);
+    pong = OpenConn(useReactor);
+    pt_extend::AddDynamicTask("ponger", Ponger);
+    pt_extend_yeild();
+
+    for (sample = 0; sample < kPingPongSamples; sample++) {
+        SampleBegin();
+        for (i = 0; i < kPingPongPerSample; i++) {
+            Send(ping);
+            if (useReactor) {
+                while (!TryRead(pong)) {
+                    pt_fd_wait_readable(*pong.watch_);
+                }
+            } else {
+                pt_extend_wait(TryRead(pong));
+            }
+        }
+        SampleEnd(kPingPongPerSample);
+    }
+    Report(useReactor ? "reactor" : "poll", idle);
+    std::exit(0);
+    pt_extend_end();
+}
+
+/* 无参数时依次以子进程运行每个场景 */
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::printf("%-8s %6s %6s %9s %9s %9s %9s %9s  (ns/roundtrip)\n",
+            "mode", "idle", "n", "mean", "p50", "p90", "p99", "max");
+        std::fflush(stdout);
+        for (const char* mode : {"poll", "reactor"}) {
+            for (uint32_t idle : kIdleConns) {
+                char command[512];
+                std::snprintf(command, sizeof(command), "%s %s %u", argv[0], mode, idle);
+                if (std::system(command) != 0) {
+                    return 1;
+                }
+            }
+        }
+        return 0;
+    }
+
+    /* 每个连接两个fd */
+    rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+
+    useReactor = argv[1][0] == 'r';
+    uintptr_t idle = std::strtoul(argv[2], nullptr, 10);
+    pt_extend::AddDynamicTask("driver", Driver, reinterpret_cast<void*>(idle));
+    pt_extend::RunSchedulerNoPriority();
+}
@@ -0,0 +1,211 @@
+/*
+ * 每次resume的开销: 任务函数里的pt_extend_begin/yield以及嵌套调用里的yield
+ * 每个样本是驱动任务连续若干轮的耗时, 除以运行的任务数, 输出ns/resume和instr/resume
+ * instr/resume来自perf_event_open的用户态指令计数, 没有硬件计数器(虚拟机等)时输出-
+ * 定义了pt_extend_task_begin时另外运行编译期区分任务函数/嵌套函数的版本
+ * g++ -std=c++20 -O2 -I.. resume_bench.cpp ../pt_extend2.cpp -o resume_bench -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if PT_EXTEND_WORK_STEALING
+#error "build resume_bench without work stealing"
+#endif
+
+static constexpr uint32_t kTasks = 64;
+static constexpr uint32_t kPassesPerSample = 100;
+static constexpr uint32_t kSamples = 2000;
+static constexpr uint32_t kWarmupSamples = 10;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+static int instrFd = -1;
+static uint64_t instrTotal;
+static uint64_t opsTotal;
+
+static void OpenInstrCounter() {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    instrFd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+
+static void SampleBegin() {
+    if (instrFd >= 0) {
+        ioctl(instrFd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(instrFd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint32_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / ops);
+    if (instrFd >= 0) {
+        ioctl(instrFd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count = 0;
+        if (read(instrFd, &count, sizeof(count)) == sizeof(count)) {
+            instrTotal += count;
+            opsTotal += ops;
+        }
+    }
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* scenario) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    char instr[32] = "-";
+    if (opsTotal != 0) {
+        std::snprintf(instr, sizeof(instr), "%.1f", static_cast<double>(instrTotal) / static_cast<double>(opsTotal));
+    }
+    std::printf("%-16s %6zu %9.2f %9.2f %9.2f %9.2f %9s\n",
+        scenario, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), instr);
+    instrTotal = 0;
+    opsTotal = 0;
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+static bool stop;
+static uint32_t exited;
+
+static void Yielder(void*) {
+    pt_extend_begin();
+    while (!stop) {
+        pt_extend_yeild();
+    }
+    ++exited;
+    pt_extend_end();
+}
+
+static void NestYield(void*) {
+    pt_extend_begin();
+    while (!stop) {
+        pt_extend_yeild();
+    }
+    pt_extend_end();
+}
+
+static void NestCaller(void*) {
+    pt_extend_begin();
+    pt_extend_call(NestYield, nullptr);
+    ++exited;
+    pt_extend_end();
+}
+
+#ifdef pt_extend_task_begin
+static void TaskYielder(void*) {
+    pt_extend_task_begin();
+    while (!stop) {
+        pt_extend_yeild();
+    }
+    ++exited;
+    pt_extend_end();
+}
+
+static void TaskNestYield(void*) {
+    pt_extend_nest_begin();
+    while (!stop) {
+        pt_extend_yeild();
+    }
+    pt_extend_end();
+}
+
+static void TaskNestCaller(void*) {
+    pt_extend_task_begin();
+    pt_extend_call(TaskNestYield, nullptr);
+    ++exited;
+    pt_extend_end();
+}
+#endif
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+struct Scenario {
+    const char* name_;
+    void (*code_)(void*);
+};
+
+static const Scenario kScenarios[] = {
+    {"yield", Yielder},
+    {"nest-yield", NestCaller},
+#ifdef pt_extend_task_begin
+    {"task-yield", TaskYielder},
+    {"task-nest-yield", TaskNestCaller},
+#endif
+};
+
+static void Driver(void*) {
+    static uint32_t scenario;
+    static uint32_t sample;
+    static uint32_t pass;
+    static uint32_t i;
+
+    pt_extend_begin();
+    std::printf("%-16s %6s %9s %9s %9s %9s %9s  (ns/resume, instr/resume)\n",
+        "scenario", "n", "mean", "p50", "p90", "p99", "instr");
+    OpenInstrCounter();
+
+    for (scenario = 0; scenario < std::size(kScenarios); scenario++) {
+        stop = false;
+        exited = 0;
+        for (i = 0; i < kTasks; i++) {
+            pt_extend::AddDynamicTask("bench", kScenarios[scenario].code_, 2u);
+        }
+        pt_extend_yeild();
+        for (sample = 0; sample < kSamples; sample++) {
+            SampleBegin();
+            for (pass = 0; pass < kPassesPerSample; pass++) {
+                pt_extend_yeild();
+            }
+            SampleEnd(kPassesPerSample * (kTasks + 1));
+        }
+        Report(kScenarios[scenario].name_);
+        stop = true;
+        pt_extend_wait(exited == kTasks);
+    }
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+    pt_extend::AddDynamicTask("driver", Driver, 2u);
+    pt_extend::RunSchedulerNoPriority();
+}
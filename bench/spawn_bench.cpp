@@ -0,0 +1,74 @@
+/*
+ * 动态任务创建/结束吞吐, 分别用对象池和new/delete编译对比
+ * 依次测试无调用栈和16层调用栈的任务
+ * g++ -std=c++20 -O2 -I.. spawn_bench.cpp ../pt_extend2.cpp -o spawn_bench_pool -pthread
+ * g++ -std=c++20 -O2 -DPT_EXTEND_TCB_POOL=0 -DPT_EXTEND_STACK_POOL=0 -I.. spawn_bench.cpp ../pt_extend2.cpp -o spawn_bench_new -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+
+static constexpr uint32_t kBatch = 1000;
+static constexpr uint32_t kWarmupRounds = 100;
+static constexpr uint32_t kRounds = 2000;
+static constexpr uint32_t kStackDepths[] = {0, 16};
+
+static void Child(void*) {
+    pt_extend_begin();
+    pt_extend_end();
+}
+
+static void Spawn(uint32_t stackDepth) {
+    if (stackDepth == 0) {
+        pt_extend::AddDynamicTask("child", Child, nullptr);
+    } else {
+        pt_extend::AddDynamicTask("child", Child, stackDepth, nullptr);
+    }
+}
+
+/* 每轮创建kBatch个立即结束的任务, 它们在同一轮内运行并释放 */
+static void Spawner(void*) {
+    static uint32_t depthIndex;
+    static uint32_t round;
+    static std::chrono::steady_clock::time_point begin;
+
+    pt_extend_begin();
+    for (depthIndex = 0; depthIndex < std::size(kStackDepths); depthIndex++) {
+        for (round = 0; round < kWarmupRounds + kRounds; round++) {
+            if (round == kWarmupRounds) {
+                begin = std::chrono::steady_clock::now();
+            }
+            for (uint32_t i = 0; i < kBatch; i++) {
+                Spawn(kStackDepths[depthIndex]);
+            }
+            pt_extend_yeild();
+        }
+
+        {
+            auto end = std::chrono::steady_clock::now();
+            double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+            double spawns = static_cast<double>(kRounds) * kBatch;
+#if PT_EXTEND_TCB_POOL
+            const char* mode = "pool";
+#else
+            const char* mode = "new/delete";
+#endif
+            std::printf("%-12s stack %2u %10.1f ns/spawn+exit %14.0f spawns/s\n",
+                mode, kStackDepths[depthIndex], ns / spawns, spawns * 1e9 / ns);
+        }
+    }
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+    pt_extend::AddDynamicTask("spawner", Spawner, nullptr);
+#if PT_EXTEND_WORK_STEALING
+    pt_extend::RunSchedulerWorkStealing(1);
+#else
+    pt_extend::RunSchedulerNoPriority();
+#endif
+}
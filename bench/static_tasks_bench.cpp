@@ -0,0 +1,149 @@
+/*
+ * 静态任务集基准: 同一组yield任务分别用AddStaticTask(就绪链表+函数指针)和StaticTaskSet(直接调用)运行
+ * 每个样本是驱动任务连续若干轮的耗时, 除以轮数和任务数, 单位ns/resume
+ * 静态任务集运行后不返回, 所以每个场景单独一个子进程
+ * g++ -std=c++20 -O2 -DPT_EXTEND_STATIC_TASK_SET=1 -I.. static_tasks_bench.cpp ../pt_extend2.cpp -o static_tasks_bench -pthread
+*/
+
+#include "pt_static_tasks.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+static constexpr uint32_t kPassesPerSample = 1000;
+static constexpr uint32_t kSamples = 2000;
+static constexpr uint32_t kWarmupSamples = 10;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint32_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / ops);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* mode, uint32_t param) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-8s %6u %6zu %9.2f %9.2f %9.2f %9.2f %9.2f\n",
+        mode, param, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), sorted.back());
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+static uint64_t resumes;
+
+template<size_t I>
+static void Yielder(void*) {
+    pt_extend_begin();
+    for (;;) {
+        ++resumes;
+        pt_extend_yeild();
+    }
+    pt_extend_end();
+}
+
+/* 每次运行是一轮 */
+static const char* mode;
+static uint32_t taskCount;
+static void Driver(void*) {
+    static uint32_t sample;
+    static uint32_t pass;
+
+    pt_extend_begin();
+    for (sample = 0; sample < kSamples; sample++) {
+        SampleBegin();
+        for (pass = 0; pass < kPassesPerSample; pass++) {
+            pt_extend_yeild();
+        }
+        SampleEnd(kPassesPerSample * (taskCount + 1));
+    }
+    Report(mode, taskCount);
+    std::exit(resumes != 0 ? 0 : 1);
+    pt_extend_end();
+}
+
+template<size_t... I>
+static auto MakeTaskSet(std::index_sequence<I...>)
+    -> pt_extend::StaticTaskSet<pt_extend::StaticTask<"driver", Driver>, pt_extend::StaticTask<"yielder", Yielder<I>>...>;
+
+template<size_t kCount>
+using YielderSet = decltype(MakeTaskSet(std::make_index_sequence<kCount>{}));
+
+// --------------------------------------------------------------------------------
+// Scenario
+// --------------------------------------------------------------------------------
+static void EmptyPass() {
+}
+
+template<size_t kCount>
+static void RunList() {
+    static pt_extend::PtExtend driverTcb;
+    static pt_extend::PtExtend tcbs[kCount];
+    pt_extend::AddStaticTask(driverTcb, "driver", Driver, nullptr);
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        (pt_extend::AddStaticTask(tcbs[I], "yielder", Yielder<I>, nullptr), ...);
+    }(std::make_index_sequence<kCount>{});
+    pt_extend::RunSchedulerStatic(&EmptyPass);
+}
+
+template<size_t kCount>
+static void RunSet() {
+    YielderSet<kCount>::Run();
+}
+
+/* 无参数时依次以子进程运行每个场景 */
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::printf("%-8s %6s %6s %9s %9s %9s %9s %9s  (ns/resume)\n",
+            "mode", "tasks", "n", "mean", "p50", "p90", "p99", "max");
+        std::fflush(stdout);
+        for (const char* m : {"list", "set"}) {
+            for (const char* count : {"16", "256"}) {
+                char command[512];
+                std::snprintf(command, sizeof(command), "%s %s %s", argv[0], m, count);
+                if (std::system(command) != 0) {
+                    return 1;
+                }
+            }
+        }
+        return 0;
+    }
+
+    mode = argv[1];
+    taskCount = static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10));
+    bool set = std::strcmp(mode, "set") == 0;
+    if (taskCount == 16) {
+        set ? RunSet<16>() : RunList<16>();
+    } else {
+        set ? RunSet<256>() : RunList<256>();
+    }
+}
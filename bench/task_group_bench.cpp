@@ -0,0 +1,257 @@
+/*
+ * fork-join和阶段屏障: 手写计数器+pt_extend_wait轮询 对比 TaskGroup
+ * fork-join: parents个父任务各自每轮启动children个子任务, 子任务yield 4次后结束, 父任务等全部结束
+ * barrier: 一个组的children个子任务每阶段yield 4次后到达屏障
+ * tail: 每轮第一个子任务改为yield这么多次, 其他任务等待它期间轮询版本每轮都要恢复所有等待者
+ * 每个样本是所有父任务跑完kRounds轮(阶段)的耗时, 除以轮数和父任务数, 单位ns/round
+ * g++ -std=c++20 -O2 -I.. task_group_bench.cpp ../pt_extend2.cpp -o task_group_bench -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if PT_EXTEND_WORK_STEALING
+#error "build task_group_bench without work stealing"
+#endif
+
+static constexpr uint32_t kRounds = 20;
+static constexpr uint32_t kSamples = 200;
+static constexpr uint32_t kWarmupSamples = 10;
+static constexpr uint32_t kMaxParents = 64;
+static constexpr uint32_t kMaxChildren = 256;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint32_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / ops);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* scenario, const char* mode, uint32_t parents, uint32_t children, uint32_t tail) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-10s %-6s %7u %8u %4u %6zu %9.1f %9.1f %9.1f %9.1f\n",
+        scenario, mode, parents, children, tail, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99));
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+/* 每个父任务的状态, 跨yield的变量不能放在栈上 */
+struct Parent {
+    uint32_t round_;
+    uint32_t i_;
+    uint32_t pending_;    /* 轮询fork-join */
+    uint32_t arrived_;    /* 轮询屏障 */
+    uint32_t generation_;
+    pt_extend::TaskGroup group_;
+};
+
+struct Worker {
+    Parent* parent_;
+    uint32_t yields_;
+    uint32_t n_;
+    uint32_t round_;
+    uint32_t generation_;
+};
+
+static Parent parents[kMaxParents];
+static Worker workers[kMaxChildren];
+static uint32_t childCount;
+static uint32_t tailYields;
+static uint32_t parentsDone;
+
+static Worker& InitWorker(Parent& p, uint32_t index) {
+    auto& w = workers[static_cast<uint32_t>(&p - parents) * childCount + index];
+    w = {&p, index == 0 ? tailYields : 4, 0, 0, 0};
+    return w;
+}
+
+static void PollChild(void* userData) {
+    auto& w = *static_cast<Worker*>(userData);
+    pt_extend_task_begin();
+    for (w.n_ = 0; w.n_ < w.yields_; w.n_++) {
+        pt_extend_yeild();
+    }
+    --w.parent_->pending_;
+    pt_extend_end();
+}
+
+static void PollForkJoin(void* userData) {
+    auto& p = *static_cast<Parent*>(userData);
+    pt_extend_task_begin();
+    for (p.round_ = 0; p.round_ < kRounds; p.round_++) {
+        p.pending_ = childCount;
+        for (p.i_ = 0; p.i_ < childCount; p.i_++) {
+            pt_extend::AddDynamicTask("child", PollChild, &InitWorker(p, p.i_));
+        }
+        pt_extend_wait(p.pending_ == 0);
+    }
+    ++parentsDone;
+    pt_extend_end();
+}
+
+static void GroupChild(void* userData) {
+    auto& w = *static_cast<Worker*>(userData);
+    pt_extend_task_begin();
+    for (w.n_ = 0; w.n_ < w.yields_; w.n_++) {
+        pt_extend_yeild();
+    }
+    pt_extend_end();
+}
+
+static void GroupForkJoin(void* userData) {
+    auto& p = *static_cast<Parent*>(userData);
+    pt_extend_task_begin();
+    for (p.round_ = 0; p.round_ < kRounds; p.round_++) {
+        for (p.i_ = 0; p.i_ < childCount; p.i_++) {
+            p.group_.Spawn("child", GroupChild, &InitWorker(p, p.i_));
+        }
+        pt_task_group_join(p.group_);
+    }
+    ++parentsDone;
+    pt_extend_end();
+}
+
+/* 轮询屏障: 最后一个到达的推进generation_, 其他的等generation_变化 */
+static void PollWorker(void* userData) {
+    auto& w = *static_cast<Worker*>(userData);
+    auto& p = *w.parent_;
+    pt_extend_task_begin();
+    for (w.round_ = 0; w.round_ < kRounds; w.round_++) {
+        for (w.n_ = 0; w.n_ < w.yields_; w.n_++) {
+            pt_extend_yeild();
+        }
+        w.generation_ = p.generation_;
+        if (++p.arrived_ == childCount) {
+            p.arrived_ = 0;
+            ++p.generation_;
+        } else {
+            pt_extend_wait(p.generation_ != w.generation_);
+        }
+    }
+    --p.pending_;
+    pt_extend_end();
+}
+
+static void PollBarrier(void* userData) {
+    auto& p = *static_cast<Parent*>(userData);
+    pt_extend_task_begin();
+    p.pending_ = childCount;
+    for (p.i_ = 0; p.i_ < childCount; p.i_++) {
+        pt_extend::AddDynamicTask("worker", PollWorker, &InitWorker(p, p.i_));
+    }
+    pt_extend_wait(p.pending_ == 0);
+    ++parentsDone;
+    pt_extend_end();
+}
+
+static void GroupWorker(void* userData) {
+    auto& w = *static_cast<Worker*>(userData);
+    pt_extend_task_begin();
+    for (w.round_ = 0; w.round_ < kRounds; w.round_++) {
+        for (w.n_ = 0; w.n_ < w.yields_; w.n_++) {
+            pt_extend_yeild();
+        }
+        pt_task_group_barrier(w.parent_->group_);
+    }
+    pt_extend_end();
+}
+
+static void GroupBarrier(void* userData) {
+    auto& p = *static_cast<Parent*>(userData);
+    pt_extend_task_begin();
+    for (p.i_ = 0; p.i_ < childCount; p.i_++) {
+        p.group_.Spawn("worker", GroupWorker, &InitWorker(p, p.i_));
+    }
+    pt_task_group_join(p.group_);
+    ++parentsDone;
+    pt_extend_end();
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+struct Scenario {
+    const char* name_;
+    const char* mode_;
+    void (*parent_)(void*);
+    uint32_t parents_;
+    uint32_t children_;
+    uint32_t tail_;
+};
+
+static const Scenario kScenarios[] = {
+    {"fork-join", "poll", PollForkJoin, 1, 64, 4},
+    {"fork-join", "group", GroupForkJoin, 1, 64, 4},
+    {"fork-join", "poll", PollForkJoin, 64, 4, 4},
+    {"fork-join", "group", GroupForkJoin, 64, 4, 4},
+    {"fork-join", "poll", PollForkJoin, 64, 4, 64},
+    {"fork-join", "group", GroupForkJoin, 64, 4, 64},
+    {"barrier", "poll", PollBarrier, 1, 256, 4},
+    {"barrier", "group", GroupBarrier, 1, 256, 4},
+    {"barrier", "poll", PollBarrier, 1, 256, 64},
+    {"barrier", "group", GroupBarrier, 1, 256, 64},
+};
+
+static void Driver(void*) {
+    static uint32_t scenario;
+    static uint32_t sample;
+    static uint32_t i;
+
+    pt_extend_begin();
+    std::printf("%-10s %-6s %7s %8s %4s %6s %9s %9s %9s %9s  (ns/round)\n",
+        "scenario", "mode", "parents", "children", "tail", "n", "mean", "p50", "p90", "p99");
+
+    for (scenario = 0; scenario < std::size(kScenarios); scenario++) {
+        childCount = kScenarios[scenario].children_;
+        tailYields = kScenarios[scenario].tail_;
+        for (sample = 0; sample < kSamples; sample++) {
+            parentsDone = 0;
+            SampleBegin();
+            for (i = 0; i < kScenarios[scenario].parents_; i++) {
+                pt_extend::AddDynamicTask("parent", kScenarios[scenario].parent_, &parents[i]);
+            }
+            pt_extend_wait(parentsDone == kScenarios[scenario].parents_);
+            SampleEnd(kScenarios[scenario].parents_ * kRounds);
+        }
+        const auto& s = kScenarios[scenario];
+        Report(s.name_, s.mode_, s.parents_, s.children_, s.tail_);
+    }
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+    pt_extend::AddDynamicTask("driver", Driver);
+    pt_extend::RunSchedulerNoPriority();
+}
@@ -0,0 +1,141 @@
+/*
+ * 大量常驻任务时每轮遍历就绪队列的开销
+ * tasks个任务一直yield, 每个样本是驱动任务一轮(所有任务各恢复一次)的耗时, 除以任务数, 单位ns/resume
+ * shuffled: 创建后把所有任务挂起再按随机顺序恢复, 就绪队列顺序和内存顺序无关
+ * 遍历只碰PtExtend(热表), 名字/统计/调用栈/定时器字段在TaskCold(冷表)
+ * g++ -std=c++20 -O2 -I.. task_table_bench.cpp ../pt_extend2.cpp -o task_table_bench -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#if PT_EXTEND_WORK_STEALING
+#error "build task_table_bench without work stealing"
+#endif
+
+static constexpr uint32_t kWarmupSamples = 2;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint32_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / ops);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* order, uint32_t tasks) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-9s %8u %5zu %8.2f %8.2f %8.2f %8.2f\n",
+        order, tasks, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99));
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+static bool stop;
+static uint32_t exited;
+
+static void Yielder(void*) {
+    pt_extend_begin();
+    while (!stop) {
+        pt_extend_yeild();
+    }
+    ++exited;
+    pt_extend_end();
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+struct Scenario {
+    const char* order_;
+    uint32_t tasks_;
+    uint32_t samples_;
+    bool shuffle_;
+};
+
+static const Scenario kScenarios[] = {
+    {"created", 1000, 2000, false},
+    {"created", 65536, 100, false},
+    {"created", 1u << 20, 12, false},
+    {"shuffled", 65536, 100, true},
+    {"shuffled", 1u << 20, 12, true},
+};
+
+static std::vector<pt_extend::PtExtend*> tasks;
+
+static void Driver(void*) {
+    static uint32_t scenario;
+    static uint32_t sample;
+
+    pt_extend_begin();
+    std::printf("sizeof(PtExtend) = %zu, alignof = %zu, sizeof(TaskCold) = %zu\n",
+        sizeof(pt_extend::PtExtend), alignof(pt_extend::PtExtend), sizeof(pt_extend::TaskCold));
+    std::printf("%-9s %8s %5s %8s %8s %8s %8s  (ns/resume)\n", "order", "tasks", "n", "mean", "p50", "p90", "p99");
+
+    for (scenario = 0; scenario < std::size(kScenarios); scenario++) {
+        stop = false;
+        exited = 0;
+        tasks.clear();
+        for (uint32_t i = 0; i < kScenarios[scenario].tasks_; i++) {
+            tasks.push_back(pt_extend::AddDynamicTask("bench", Yielder));
+        }
+        if (kScenarios[scenario].shuffle_) {
+            for (auto* task : tasks) {
+                pt_extend::SuspendTask(*task);
+            }
+            std::shuffle(tasks.begin(), tasks.end(), std::mt19937{1});
+            for (auto* task : tasks) {
+                pt_extend::ResumeTask(*task);
+            }
+        }
+        pt_extend_yeild();
+
+        for (sample = 0; sample < kScenarios[scenario].samples_; sample++) {
+            SampleBegin();
+            pt_extend_yeild();
+            SampleEnd(kScenarios[scenario].tasks_);
+        }
+        Report(kScenarios[scenario].order_, kScenarios[scenario].tasks_);
+
+        stop = true;
+        pt_extend_wait(exited == kScenarios[scenario].tasks_);
+    }
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+    pt_extend::AddDynamicTask("driver", Driver);
+    pt_extend::RunSchedulerNoPriority();
+}
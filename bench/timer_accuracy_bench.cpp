@@ -0,0 +1,101 @@
+/*
+ * 延时精度: 不同tick分辨率下pt_extend_delay_us比请求的时间晚醒多少
+ * 一个任务反复延时delay微秒, 每个样本是一次延时的实际耗时减去delay, 单位us
+ * tick分辨率由命令行参数指定(微秒, 默认1000), 每个进程只能在调度器运行前设置一次
+ * 加-DPT_EXTEND_EPOLL_REACTOR=1 -DPT_EXTEND_TIMERFD=1 比较timerfd和条件变量的睡眠
+ * g++ -std=c++20 -O2 -I.. timer_accuracy_bench.cpp ../pt_extend2.cpp -o timer_accuracy_bench -pthread
+ * ./timer_accuracy_bench 1000 && ./timer_accuracy_bench 100 && ./timer_accuracy_bench 10
+*/
+
+#include "pt_extend2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if !PT_EXTEND_TICKLESS_IDLE
+#error "build timer_accuracy_bench with tickless idle"
+#endif
+
+static constexpr uint32_t kWarmupSamples = 10;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* expectUs: 请求的延时 */
+static void SampleEnd(uint32_t expectUs) {
+    double us = std::chrono::duration<double, std::micro>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(us - expectUs);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(uint32_t delayUs) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%7u %7u %6zu %8.1f %8.1f %8.1f %8.1f %8.1f\n",
+        pt_extend::tickResolutionUs, delayUs, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99), sorted.back());
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+struct Scenario {
+    uint32_t delayUs_;
+    uint32_t samples_;
+};
+
+static const Scenario kScenarios[] = {
+    {50, 1000},
+    {250, 1000},
+    {1000, 500},
+    {10000, 100},
+};
+
+static void Driver(void*) {
+    static uint32_t scenario;
+    static uint32_t sample;
+
+    pt_extend_begin();
+    std::printf("%7s %7s %6s %8s %8s %8s %8s %8s  (us late)\n",
+        "tick", "delay", "n", "mean", "p50", "p90", "p99", "max");
+
+    for (scenario = 0; scenario < std::size(kScenarios); scenario++) {
+        for (sample = 0; sample < kScenarios[scenario].samples_; sample++) {
+            SampleBegin();
+            pt_extend_delay_us(kScenarios[scenario].delayUs_);
+            SampleEnd(kScenarios[scenario].delayUs_);
+        }
+        Report(kScenarios[scenario].delayUs_);
+    }
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main(int argc, char** argv) {
+    pt_extend::SetTickResolution(argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : pt_extend::kDefaultTickUs);
+    pt_extend::AddDynamicTask("driver", Driver);
+    pt_extend::RunSchedulerNoPriority();
+}
@@ -0,0 +1,106 @@
+/*
+ * 时间轮每tick开销测试
+ * expire列: 每个睡眠任务的周期和睡眠任务数成正比, 每tick固定到期kExpirePerTick个, 不同N之间可以直接比较
+ * idle列: 测量期间没有任务到期, 只有推进和级联的开销
+ * expire列在N很大时的增长来自节点超出缓存(每次到期和级联都是随机访问)以及周期每大64倍多一级级联, 不是扫描
+ * g++ -std=c++20 -O2 -I.. timer_wheel_bench.cpp -o timer_wheel_bench
+*/
+
+#include "pt_timer_wheel.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+struct Node {
+    Node* next_{};
+    Node* prev_{};
+    int32_t delay_{};
+    uint64_t wakeTick_{};
+    uint16_t wheelSlot_{};
+};
+
+/* 原来的做法: 每tick遍历全部延时任务并递减 */
+struct LinearList {
+    Node* head_{};
+    Node* tail_{};
+
+    void Add(Node* node, int32_t ticks) {
+        node->delay_ = ticks;
+        node->prev_ = tail_;
+        node->next_ = nullptr;
+        if (tail_) {
+            tail_->next_ = node;
+        } else {
+            head_ = node;
+        }
+        tail_ = node;
+    }
+
+    template<class F>
+    void Advance(uint32_t ticks, F&& onExpire) {
+        auto* node = head_;
+        while (node) {
+            auto* next = node->next_;
+            node->delay_ -= ticks;
+            if (node->delay_ <= 0) {
+                if (node->prev_) node->prev_->next_ = node->next_; else head_ = node->next_;
+                if (node->next_) node->next_->prev_ = node->prev_; else tail_ = node->prev_;
+                onExpire(node);
+            }
+            node = next;
+        }
+    }
+};
+
+static constexpr uint32_t kExpirePerTick = 1;
+
+/* idle为true时所有任务都在测量结束之后才到期 */
+template<class Delay>
+static double MeasureTick(uint32_t sleepers, uint32_t ticks, bool idle) {
+    /* 初始延时在[1, period]内均匀分布, 到期后固定睡眠period, 每tick到期数保持sleepers/period */
+    int32_t period = static_cast<int32_t>(sleepers / kExpirePerTick);
+    int32_t base = idle ? static_cast<int32_t>(ticks) : 0;
+    std::mt19937 rng{sleepers};
+    std::uniform_int_distribution<int32_t> dist{1, period};
+    std::vector<Node> nodes(sleepers);
+    auto* delay = new Delay{};
+    for (auto& n : nodes) {
+        delay->Add(&n, base + dist(rng));
+    }
+
+    std::vector<Node*> expired;
+    uint64_t expiredCount = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ticks; i++) {
+        delay->Advance(1, [&](Node* n) { expired.push_back(n); });
+        expiredCount += expired.size();
+        for (auto* n : expired) {
+            delay->Add(n, period);
+        }
+        expired.clear();
+    }
+    auto end = std::chrono::steady_clock::now();
+    delete delay;
+    if (idle && expiredCount != 0) {
+        std::printf("unexpected expiry in idle run\n");
+        std::exit(1);
+    }
+    return std::chrono::duration<double, std::nano>(end - begin).count() / ticks;
+}
+
+int main() {
+    static constexpr uint32_t kSleepers[] = {100, 1000, 10000, 100000, 1000000};
+    std::printf("%10s %12s %18s %16s %18s %16s\n", "sleepers", "expire/tick",
+        "wheel expire ns", "wheel idle ns", "linear expire ns", "linear idle ns");
+    for (uint32_t n : kSleepers) {
+        uint32_t linearTicks = n >= 100000 ? 200 : 2000;
+        double wheelExpire = MeasureTick<pt_extend::TimerWheel<Node>>(n, 60000, false);
+        double wheelIdle = MeasureTick<pt_extend::TimerWheel<Node>>(n, 60000, true);
+        double linearExpire = MeasureTick<LinearList>(n, linearTicks, false);
+        double linearIdle = MeasureTick<LinearList>(n, linearTicks, true);
+        std::printf("%10u %12u %18.1f %16.1f %18.1f %16.1f\n", n, kExpirePerTick,
+            wheelExpire, wheelIdle, linearExpire, linearIdle);
+    }
+}
@@ -0,0 +1,172 @@
+/*
+ * 大量任务等待很少变化的标志: pt_extend_wait轮询 对比 WaitQueue
+ * waiters个任务各自等待自己的标志变化, 驱动任务每轮改变其中一个标志后yield
+ * 轮询版本每轮要恢复所有等待者, WaitQueue版本只恢复被Notify的那一个
+ * 每个样本是驱动任务kRoundsPerSample轮的耗时, 除以轮数, 单位ns/round
+ * g++ -std=c++20 -O2 -I.. wait_queue_bench.cpp ../pt_extend2.cpp -o wait_queue_bench -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#if PT_EXTEND_WORK_STEALING
+#error "build wait_queue_bench without work stealing"
+#endif
+
+static constexpr uint32_t kMaxWaiters = 10000;
+static constexpr uint32_t kRoundsPerSample = 100;
+static constexpr uint32_t kSamples = 200;
+static constexpr uint32_t kWarmupSamples = 10;
+
+// --------------------------------------------------------------------------------
+// Samples
+// --------------------------------------------------------------------------------
+using BenchClock = std::chrono::steady_clock;
+
+static std::vector<double> samples;
+static BenchClock::time_point sampleBegin;
+
+static void SampleBegin() {
+    sampleBegin = BenchClock::now();
+}
+
+/* ops: 本样本内的操作数 */
+static void SampleEnd(uint32_t ops) {
+    double ns = std::chrono::duration<double, std::nano>(BenchClock::now() - sampleBegin).count();
+    samples.push_back(ns / ops);
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+/* 丢弃前kWarmupSamples个样本后输出并清空 */
+static void Report(const char* mode, uint32_t waiters) {
+    std::vector<double> sorted(samples.begin() + kWarmupSamples, samples.end());
+    samples.clear();
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0;
+    for (double v : sorted) {
+        sum += v;
+    }
+    std::printf("%-6s %8u %6zu %10.1f %10.1f %10.1f %10.1f\n",
+        mode, waiters, sorted.size(), sum / static_cast<double>(sorted.size()),
+        Percentile(sorted, 0.5), Percentile(sorted, 0.9), Percentile(sorted, 0.99));
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+/* 每个等待者的标志, 跨yield的变量不能放在栈上 */
+struct Waiter {
+    uint32_t flag_;
+    uint32_t seen_;
+    pt_extend::WaitQueue queue_;
+};
+
+static Waiter waiters[kMaxWaiters];
+static uint32_t waiterCount;
+static bool stop;
+static uint32_t exited;
+
+static void PollWaiter(void* userData) {
+    auto& w = *static_cast<Waiter*>(userData);
+    pt_extend_begin();
+    while (!stop) {
+        pt_extend_wait(stop || w.flag_ != w.seen_);
+        w.seen_ = w.flag_;
+    }
+    ++exited;
+    pt_extend_end();
+}
+
+static void QueueWaiter(void* userData) {
+    auto& w = *static_cast<Waiter*>(userData);
+    pt_extend_begin();
+    while (!stop) {
+        pt_wait_queue_wait(w.queue_, stop || w.flag_ != w.seen_);
+        w.seen_ = w.flag_;
+    }
+    ++exited;
+    pt_extend_end();
+}
+
+/* 改变一个标志, 通知它的等待者 */
+static void Signal(Waiter& w) {
+    ++w.flag_;
+    w.queue_.Notify();
+}
+
+// --------------------------------------------------------------------------------
+// Driver
+// --------------------------------------------------------------------------------
+struct Scenario {
+    const char* mode_;
+    void (*waiter_)(void*);
+    uint32_t waiters_;
+};
+
+static const Scenario kScenarios[] = {
+    {"poll", PollWaiter, 10},
+    {"queue", QueueWaiter, 10},
+    {"poll", PollWaiter, 1000},
+    {"queue", QueueWaiter, 1000},
+    {"poll", PollWaiter, 10000},
+    {"queue", QueueWaiter, 10000},
+};
+
+static void Driver(void*) {
+    static uint32_t scenario;
+    static uint32_t sample;
+    static uint32_t round;
+    static uint32_t next;
+    static uint32_t i;
+
+    pt_extend_begin();
+    std::printf("%-6s %8s %6s %10s %10s %10s %10s  (ns/round)\n",
+        "mode", "waiters", "n", "mean", "p50", "p90", "p99");
+
+    for (scenario = 0; scenario < std::size(kScenarios); scenario++) {
+        stop = false;
+        exited = 0;
+        next = 0;
+        waiterCount = kScenarios[scenario].waiters_;
+        for (i = 0; i < waiterCount; i++) {
+            waiters[i].flag_ = 0;
+            waiters[i].seen_ = 0;
+            pt_extend::AddDynamicTask("waiter", kScenarios[scenario].waiter_, &waiters[i]);
+        }
+        pt_extend_yeild();
+
+        for (sample = 0; sample < kSamples; sample++) {
+            SampleBegin();
+            for (round = 0; round < kRoundsPerSample; round++) {
+                Signal(waiters[next]);
+                next = next + 1 == waiterCount ? 0 : next + 1;
+                pt_extend_yeild();
+            }
+            SampleEnd(kRoundsPerSample);
+        }
+        Report(kScenarios[scenario].mode_, waiterCount);
+
+        stop = true;
+        for (i = 0; i < waiterCount; i++) {
+            waiters[i].queue_.Notify();
+        }
+        pt_extend_wait(exited == waiterCount);
+    }
+
+    std::exit(0);
+    pt_extend_end();
+}
+
+int main() {
+    pt_extend::AddDynamicTask("driver", Driver);
+    pt_extend::RunSchedulerNoPriority();
+}
@@ -0,0 +1,63 @@
+/*
+ * 工作窃取调度扩展性测试, worker数量1~64
+ * g++ -std=c++20 -O2 -DPT_EXTEND_WORK_STEALING=1 -I.. work_stealing_bench.cpp ../pt_extend2.cpp -o work_stealing_bench -pthread
+*/
+
+#include "pt_extend2.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+static constexpr uint32_t kTasks = 4096;
+static constexpr uint32_t kResumes = 200;
+static constexpr uint32_t kWorkPerResume = 2000;
+
+struct BenchTask {
+    uint32_t resume;
+    uint64_t acc;
+};
+
+static std::atomic<uint32_t> finished;
+
+/* 每次恢复做一点计算再yield, 模拟互相独立的协程 */
+static void Worker(void* userData) {
+    auto* t = static_cast<BenchTask*>(userData);
+    pt_extend_begin();
+    for (t->resume = 0; t->resume < kResumes; t->resume++) {
+        for (uint32_t i = 0; i < kWorkPerResume; i++) {
+            t->acc = t->acc * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        pt_extend_yeild();
+    }
+    if (++finished == kTasks) {
+        pt_extend::StopSchedulerWorkStealing();
+    }
+    pt_extend_end();
+}
+
+static double RunOnce(uint32_t workers) {
+    std::vector<BenchTask> tasks(kTasks);
+    finished = 0;
+    for (auto& t : tasks) {
+        pt_extend::AddDynamicTask("bench", Worker, 1, &t);
+    }
+    auto begin = std::chrono::steady_clock::now();
+    pt_extend::RunSchedulerWorkStealing(workers);
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - begin).count();
+}
+
+int main() {
+    static constexpr uint32_t kWorkers[] = {1, 2, 4, 8, 16, 32, 64};
+    std::printf("%8s %12s %16s %10s\n", "workers", "seconds", "resumes/s", "speedup");
+    double base = 0;
+    for (uint32_t w : kWorkers) {
+        double seconds = RunOnce(w);
+        if (base == 0) {
+            base = seconds;
+        }
+        double resumes = static_cast<double>(kTasks) * (kResumes + 1);
+        std::printf("%8u %12.3f %16.0f %10.2f\n", w, seconds, resumes / seconds, base / seconds);
+    }
+}
@@ -47,39 +47,8 @@ void NestNestedFunc(void*) {
 
     std::cout << "[NestNestedFunc]: wait test\n";
     pt_extend::AddDynamicTask("ResumeCondition", ResumeCondition, nullptr);
-    do
-    {
-        for (;;)
-        {
-            volatile int32_t b = --(e_).num_;
-            if (b == (e_).num_)
-            {
-                if (b < 0)
-                {
-                    pt_extend::RemoveFromReadyList(pt_extend::GetCurrentTask());
-                    pt_extend::AddToListEnd(e_.list_, pt_extend::GetCurrentTask());
-                    do
-                    {
-                        do
-                        {
-                            (pt_extend::GetCurrentCallPt())->status = (-2);
-                        _pt_label50:
-                            (pt_extend::GetCurrentCallPt())->label = &&_pt_label50;
-                        } while (0);
-                        if ((pt_extend::GetCurrentCallPt())->status == -2)
-                        {
-                            (pt_extend::GetCurrentCallPt())->status = 0;
-                            return;
-                        }
-                    } while (0);
-                    ;
-                    break;
-                }
-            }
-        }
-    } while (0);
-            std::cout
-        << "[NestNestedFunc]: resume from wait\n";
+    pt_event_take(e_);
+    std::cout << "[NestNestedFunc]: resume from wait\n";
 
     std::cout << "[NestNestedFunc]: delay\n";
     pt_extend_delay(1000);
@@ -122,6 +91,7 @@ void Nested(void*) {
     pt_extend_end();
 }
 
+#if !PT_EXTEND_TICKLESS_IDLE
 void SysTick() {
     auto start = std::chrono::steady_clock::now();
     for (;;) {
@@ -134,14 +104,21 @@ void SysTick() {
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
     }
 }
+#endif
 
 int main() {
     std::cout << std::endl;
 
+#if !PT_EXTEND_TICKLESS_IDLE
     std::jthread t1{SysTick};
     t1.detach();
+#endif
 
     pt_extend::AddDynamicTask("Nested", Nested, 16);
 
+#if PT_EXTEND_WORK_STEALING
+    pt_extend::RunSchedulerWorkStealing(std::thread::hardware_concurrency());
+#else
     pt_extend::RunSchedulerNoPriority();
+#endif
 }
\ No newline at end of file
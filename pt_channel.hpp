@@ -0,0 +1,174 @@
+/*
+ * Bounded Channel
+ * 有界通道, 槽位就地读写(reserve/commit, acquire/release)不需要拷贝
+ * 空位和数据各用一个PtEvent计数, 满/空时任务挂在对应事件上, 由对端直接唤醒
+ * PtSpscChannel: 单生产者单消费者, 位置不需要原子操作
+ * PtMpmcChannel: 多生产者多消费者, 每个槽位带序号, 用CAS认领
+*/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "pt_extend2.hpp"
+
+namespace pt_extend {
+
+template<class T, bool kMultiple>
+struct PtChannelSlot {
+    T value_{};
+};
+
+template<class T>
+struct PtChannelSlot<T, true> {
+    std::atomic<uint32_t> seq_{}; /* ==pos可写, ==pos+1可读 */
+    T value_{};
+};
+
+template<class T, uint32_t kCapacity, bool kMultiple>
+class PtChannel {
+public:
+    static_assert(kCapacity != 0 && (kCapacity & (kCapacity - 1)) == 0, "kCapacity must be a power of 2");
+    using Slot = PtChannelSlot<T, kMultiple>;
+
+    PtChannel() {
+        slots_.count_.store(static_cast<int32_t>(kCapacity), std::memory_order_relaxed);
+        if constexpr (kMultiple) {
+            for (uint32_t i = 0; i < kCapacity; i++) {
+                cells_[i].seq_.store(i, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    PtChannel(const PtChannel&) = delete;
+    PtChannel& operator=(const PtChannel&) = delete;
+
+    /* 不阻塞, 满时返回nullptr */
+    Slot* TryReserve() {
+        if (!slots_.TryTake()) {
+            return nullptr;
+        }
+        auto* slot = ClaimSend();
+        if (slot == nullptr) {
+            slots_.Give();
+        }
+        return slot;
+    }
+
+    /* 不阻塞, 空时返回nullptr */
+    Slot* TryAcquire() {
+        if (!items_.TryTake()) {
+            return nullptr;
+        }
+        auto* slot = ClaimRecv();
+        if (slot == nullptr) {
+            items_.Give();
+        }
+        return slot;
+    }
+
+    /* 写完槽位后发布给消费者 */
+    void Commit(Slot* slot) {
+        if constexpr (kMultiple) {
+            slot->seq_.store(slot->seq_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+        items_.Give();
+    }
+
+    /* 读完槽位后还给生产者 */
+    void Release(Slot* slot) {
+        if constexpr (kMultiple) {
+            slot->seq_.store(slot->seq_.load(std::memory_order_relaxed) - 1 + kCapacity, std::memory_order_release);
+        }
+        slots_.Give();
+    }
+
+    /* 以下由宏使用: 已经持有计数后认领下一个槽位.
+     * 多生产者/消费者时前一圈的对端可能还没用完这个槽位, 返回nullptr由调用者稍后重试 */
+    Slot* ClaimSend() {
+        if constexpr (kMultiple) {
+            return Claim(tail_, 0);
+        } else {
+            return &cells_[tail_++ & kMask];
+        }
+    }
+
+    Slot* ClaimRecv() {
+        if constexpr (kMultiple) {
+            return Claim(head_, 1);
+        } else {
+            return &cells_[head_++ & kMask];
+        }
+    }
+
+    PtEvent slots_; /* 空位计数 */
+    PtEvent items_; /* 数据计数 */
+
+private:
+    static constexpr uint32_t kMask = kCapacity - 1;
+    using Position = std::conditional_t<kMultiple, std::atomic<uint32_t>, uint32_t>;
+
+    /* Vyukov有界队列的认领: 序号等于pos+ready才可以认领 */
+    Slot* Claim(std::atomic<uint32_t>& position, uint32_t ready) {
+        uint32_t pos = position.load(std::memory_order_relaxed);
+        for (;;) {
+            auto& cell = cells_[pos & kMask];
+            int32_t diff = static_cast<int32_t>(cell.seq_.load(std::memory_order_acquire) - (pos + ready));
+            if (diff == 0) {
+                if (position.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return &cell;
+                }
+            } else if (diff < 0) {
+                return nullptr;
+            } else {
+                pos = position.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    alignas(64) Position tail_{};
+    alignas(64) Position head_{};
+    Slot cells_[kCapacity];
+};
+
+template<class T, uint32_t kCapacity>
+using PtSpscChannel = PtChannel<T, kCapacity, false>;
+
+template<class T, uint32_t kCapacity>
+using PtMpmcChannel = PtChannel<T, kCapacity, true>;
+
+}
+
+// --------------------------------------------------------------------------------
+// Channel
+// --------------------------------------------------------------------------------
+/* slot是Slot*变量, 满时让出直到有空位, 之后直接写slot->value_再Commit */
+#define pt_channel_reserve(ch, slot)\
+    do {\
+        pt_event_take((ch).slots_);\
+        _pt_extend_unduplicate_wait(pt_extend::GetCurrentCallPt(), ((slot) = (ch).ClaimSend()) != nullptr);\
+    } while (0)
+
+/* slot是Slot*变量, 空时让出直到有数据, 之后直接读slot->value_再Release */
+#define pt_channel_acquire(ch, slot)\
+    do {\
+        pt_event_take((ch).items_);\
+        _pt_extend_unduplicate_wait(pt_extend::GetCurrentCallPt(), ((slot) = (ch).ClaimRecv()) != nullptr);\
+    } while (0)
+
+/* 拷贝发送, value在可能的让出之后才求值 */
+#define pt_channel_send(ch, slot, value)\
+    do {\
+        pt_channel_reserve(ch, slot);\
+        (slot)->value_ = (value);\
+        (ch).Commit((slot));\
+    } while (0)
+
+/* 移动接收到out */
+#define pt_channel_recv(ch, slot, out)\
+    do {\
+        pt_channel_acquire(ch, slot);\
+        (out) = std::move((slot)->value_);\
+        (ch).Release((slot));\
+    } while (0)
@@ -0,0 +1,318 @@
+/*
+ * C++20 Coroutine Front End
+ * 协程任务和宏任务共用同一个调度器, 就绪/延时/事件链表完全相同
+ * 每个协程任务是一个动态TCB, taskCode_恢复当前最内层的协程
+ * 嵌套调用 co_await CoTask<T> 直接对称转移, 返回时转回调用者
+ * 协程帧从AllocateCoroutineFrame分配(PT_EXTEND_COROUTINE_FRAME_POOL)
+*/
+
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include "pt_extend2.hpp"
+
+namespace pt_extend {
+
+template<class T = void>
+class CoTask;
+
+namespace detail {
+
+struct CoPromiseBase {
+    std::coroutine_handle<> continuation_;
+    CoPromiseBase* root_ = this;
+    std::coroutine_handle<> leaf_; /* 只在根协程上使用: 任务下次运行时恢复的协程 */
+
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+
+        /* 嵌套调用结束, 转回调用者; 根协程结束, 回到调度器 */
+        template<class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> self) const noexcept {
+            auto& promise = self.promise();
+            if (promise.continuation_) {
+                promise.root_->leaf_ = promise.continuation_;
+                return promise.continuation_;
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() const noexcept { std::terminate(); }
+
+    static void* operator new(size_t size) noexcept {
+        return AllocateCoroutineFrame(size);
+    }
+
+    static void operator delete(void* frame, size_t size) noexcept {
+        FreeCoroutineFrame(frame, size);
+    }
+};
+
+template<class T>
+struct CoPromise : CoPromiseBase {
+    std::optional<T> value_;
+
+    CoTask<T> get_return_object() noexcept;
+    static CoTask<T> get_return_object_on_allocation_failure() noexcept;
+
+    template<class U>
+    void return_value(U&& value) {
+        value_.emplace(std::forward<U>(value));
+    }
+};
+
+template<>
+struct CoPromise<void> : CoPromiseBase {
+    CoTask<void> get_return_object() noexcept;
+    static CoTask<void> get_return_object_on_allocation_failure() noexcept;
+
+    void return_void() const noexcept {}
+};
+
+}
+
+/* 惰性启动, 由AddCoroutineTask作为任务运行, 或者在另一个协程里co_await */
+template<class T>
+class [[nodiscard]] CoTask {
+public:
+    using promise_type = detail::CoPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit CoTask(Handle handle) noexcept
+        : handle_(handle) {
+    }
+
+    CoTask(CoTask&& other) noexcept
+        : handle_(std::exchange(other.handle_, {})) {
+    }
+
+    CoTask(const CoTask&) = delete;
+    CoTask& operator=(const CoTask&) = delete;
+    CoTask& operator=(CoTask&&) = delete;
+
+    ~CoTask() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    /* 协程帧分配失败时为false */
+    explicit operator bool() const noexcept { return static_cast<bool>(handle_); }
+
+    Handle Release() noexcept { return std::exchange(handle_, {}); }
+
+    struct Awaiter {
+        Handle handle_;
+
+        bool await_ready() const noexcept { return false; }
+
+        template<class P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> caller) const noexcept {
+            /* 嵌套调用的协程帧分配失败, 没有办法继续 */
+            if (!handle_) {
+                std::terminate();
+            }
+            auto& callee = handle_.promise();
+            callee.continuation_ = caller;
+            callee.root_ = caller.promise().root_;
+            callee.root_->leaf_ = handle_;
+            return handle_;
+        }
+
+        T await_resume() const {
+            if constexpr (!std::is_void_v<T>) {
+                return std::move(*handle_.promise().value_);
+            }
+        }
+    };
+
+    Awaiter operator co_await() && noexcept { return Awaiter{handle_}; }
+
+private:
+    Handle handle_;
+};
+
+namespace detail {
+
+template<class T>
+CoTask<T> CoPromise<T>::get_return_object() noexcept {
+    return CoTask<T>{std::coroutine_handle<CoPromise<T>>::from_promise(*this)};
+}
+
+template<class T>
+CoTask<T> CoPromise<T>::get_return_object_on_allocation_failure() noexcept {
+    return CoTask<T>{nullptr};
+}
+
+inline CoTask<void> CoPromise<void>::get_return_object() noexcept {
+    return CoTask<void>{std::coroutine_handle<CoPromise<void>>::from_promise(*this)};
+}
+
+inline CoTask<void> CoPromise<void>::get_return_object_on_allocation_failure() noexcept {
+    return CoTask<void>{nullptr};
+}
+
+/* 协程任务的taskCode_, 根协程结束时和pt_extend_co_dynamic_end一样删除任务 */
+inline void ResumeCoroutineTask(void* userData) {
+    auto* root = static_cast<CoPromiseBase*>(userData);
+    root->leaf_.resume();
+    if (root->leaf_.done()) {
+        root->leaf_.destroy();
+        RemoveFromReadyList(GetCurrentTask());
+        DynamicDeleteCurrent();
+    }
+}
+
+}
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+/* 失败返回nullptr */
+inline PtExtend* AddCoroutineTask(std::string_view name, CoTask<> task) {
+    if (!task) {
+        return nullptr;
+    }
+    auto handle = task.Release();
+    detail::CoPromiseBase* root = &handle.promise();
+    root->leaf_ = handle;
+    auto* pt = AddDynamicTask(name, detail::ResumeCoroutineTask, root);
+    if (pt == nullptr) {
+        handle.destroy();
+    }
+    return pt;
+}
+
+// --------------------------------------------------------------------------------
+// Awaitable
+// --------------------------------------------------------------------------------
+/* co_await CoYield(): 让出, 仍然就绪 */
+struct CoYield {
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<>) const noexcept {}
+    void await_resume() const noexcept {}
+};
+
+/* 直接以tick为单位的时间参数, 例如CoDelay(CoTicks{n}) */
+struct CoTicks {
+    int64_t ticks_;
+};
+
+/* co_await CoDelay(ms): 和pt_extend_delay一样进入延时结构 */
+struct CoDelay {
+    int64_t ticks_;
+
+    explicit CoDelay(int64_t ms) noexcept
+        : ticks_(Ms2Ticks(ms)) {
+    }
+
+    explicit CoDelay(CoTicks ticks) noexcept
+        : ticks_(ticks.ticks_) {
+    }
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<>) const noexcept {
+        RemoveFromReadyAddToWaitList(GetCurrentTask(), ticks_);
+    }
+
+    void await_resume() const noexcept {}
+};
+
+/* co_await CoDelayUs(us): 同pt_extend_delay_us */
+inline CoDelay CoDelayUs(int64_t us) noexcept {
+    return CoDelay{CoTicks{Us2Ticks(us)}};
+}
+
+/* co_await CoDelayUntil(lastWake, ms): 同pt_extend_delay_until */
+struct CoDelayUntil {
+    uint64_t& lastWake_;
+    int64_t ticks_;
+
+    CoDelayUntil(uint64_t& lastWake, int64_t periodMs) noexcept
+        : lastWake_(lastWake)
+        , ticks_(Ms2Ticks(periodMs)) {
+    }
+
+    CoDelayUntil(uint64_t& lastWake, CoTicks period) noexcept
+        : lastWake_(lastWake)
+        , ticks_(period.ticks_) {
+    }
+
+    bool await_ready() const noexcept { return !DelayUntil(lastWake_, ticks_); }
+    void await_suspend(std::coroutine_handle<>) const noexcept {
+        RemoveFromReadyAddToWaitList(GetCurrentTask(), TicksUntil(lastWake_));
+    }
+    void await_resume() const noexcept {}
+};
+
+/* co_await CoTake(e): 同pt_event_take */
+struct CoTake {
+    PtEvent& event_;
+
+    bool await_ready() const noexcept { return event_.TryTake(); }
+    bool await_suspend(std::coroutine_handle<>) const noexcept { return event_.TakeOrPark(); }
+    void await_resume() const noexcept {}
+};
+
+/* co_await CoTakeTimeout(e, ms): 同pt_event_take_timeout, 返回true表示取到, false表示超时 */
+struct CoTakeTimeout {
+    PtEvent& event_;
+    int64_t ticks_;
+
+    CoTakeTimeout(PtEvent& event, int64_t ms) noexcept
+        : event_(event)
+        , ticks_(Ms2Ticks(ms)) {
+    }
+
+    CoTakeTimeout(PtEvent& event, CoTicks timeout) noexcept
+        : event_(event)
+        , ticks_(timeout.ticks_) {
+    }
+
+    bool await_ready() const noexcept {
+        GetCurrentTask()->waitResult_ = kWaitSignaled;
+        return event_.TryTake();
+    }
+
+    bool await_suspend(std::coroutine_handle<>) const noexcept { return event_.TakeOrPark(ticks_); }
+    bool await_resume() const noexcept { return GetCurrentTask()->waitResult_ != kWaitTimeout; }
+};
+
+/* co_await CoTakeTimeoutUs(e, us): 超时以微秒为单位的CoTakeTimeout */
+inline CoTakeTimeout CoTakeTimeoutUs(PtEvent& event, int64_t us) noexcept {
+    return CoTakeTimeout{event, CoTicks{Us2Ticks(us)}};
+}
+
+#if PT_EXTEND_EPOLL_REACTOR
+/* co_await CoWaitFd{f, kFdReadable}: 同pt_fd_wait_readable/pt_fd_wait_writable */
+struct CoWaitFd {
+    PtFd& fd_;
+    uint32_t interest_;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<>) const noexcept { return fd_.WaitOrPark(interest_); }
+    void await_resume() const noexcept {}
+};
+#endif
+
+#if PT_EXTEND_IO_URING
+/* co_await CoIo{io}: 同pt_io_submit, io先用PrepareIo填好, 返回io.result_ */
+struct CoIo {
+    PtIo& io_;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<>) const { SubmitIo(io_); }
+    int32_t await_resume() const noexcept { return io_.result_; }
+};
+#endif
+
+}
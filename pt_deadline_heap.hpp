@@ -0,0 +1,90 @@
+/*
+ * Deadline Heap
+ * 按截止时间排序的二叉小顶堆, 插入/删除O(log n), 取最早截止O(1)
+ * 节点记录自己在堆里的下标, 可以删除任意节点
+*/
+
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace pt_extend {
+
+/* Node需要提供kKey指向的截止时间和kIndex指向的下标, 默认是 deadline_ heapIndex_ */
+template<class Node, uint64_t Node::*kKey = &Node::deadline_, uint32_t Node::*kIndex = &Node::heapIndex_>
+class DeadlineHeap {
+public:
+    bool Empty() const { return nodes_.empty(); }
+    uint32_t Size() const { return static_cast<uint32_t>(nodes_.size()); }
+
+    /* 截止时间最早的节点, 堆不能为空 */
+    Node* Top() const { return nodes_.front(); }
+
+    void Push(Node* node) {
+        nodes_.push_back(node);
+        SiftUp(node, Size() - 1);
+    }
+
+    void Remove(Node* node) {
+        uint32_t index = node->*kIndex;
+        Node* last = nodes_.back();
+        nodes_.pop_back();
+        if (last == node) {
+            return;
+        }
+        if (index > 0 && Earlier(last, nodes_[Parent(index)])) {
+            SiftUp(last, index);
+        } else {
+            SiftDown(last, index);
+        }
+    }
+
+    /* 预分配count个节点的空间, 之后Push不再分配 */
+    void Reserve(uint32_t count) { nodes_.reserve(count); }
+
+private:
+    static uint32_t Parent(uint32_t index) { return (index - 1) / 2; }
+
+    static bool Earlier(const Node* a, const Node* b) { return a->*kKey < b->*kKey; }
+
+    void Place(Node* node, uint32_t index) {
+        nodes_[index] = node;
+        node->*kIndex = index;
+    }
+
+    /* 从index向上找node的位置, 路径上的节点下移 */
+    void SiftUp(Node* node, uint32_t index) {
+        while (index > 0) {
+            uint32_t parent = Parent(index);
+            if (!Earlier(node, nodes_[parent])) {
+                break;
+            }
+            Place(nodes_[parent], index);
+            index = parent;
+        }
+        Place(node, index);
+    }
+
+    void SiftDown(Node* node, uint32_t index) {
+        uint32_t size = Size();
+        for (;;) {
+            uint32_t child = index * 2 + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && Earlier(nodes_[child + 1], nodes_[child])) {
+                ++child;
+            }
+            if (!Earlier(nodes_[child], node)) {
+                break;
+            }
+            Place(nodes_[child], index);
+            index = child;
+        }
+        Place(node, index);
+    }
+
+    std::vector<Node*> nodes_;
+};
+
+}
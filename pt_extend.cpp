@@ -1,4 +1,5 @@
 #include "pt_extend.hpp"
+#include "pt_timer_wheel.hpp"
 #include <format>
 #include <iostream>
 #include <atomic>
@@ -44,11 +45,11 @@ static void RemoveFromList(RefList& list, PtExtend* pt) {
 // --------------------------------------------------------------------------------
 // Detail List
 // --------------------------------------------------------------------------------
-static RefList waitList = {nullptr, nullptr};
+static TimerWheel<PtExtend> waitWheel;
 static RefList readyList = {nullptr, nullptr};
 void RemoveFromReadyAddToWaitList(PtExtend* pt) {
     RemoveFromList(readyList, pt);
-    AddToListEnd(waitList, pt);
+    waitWheel.Add(pt, pt->delay_);
 }
 
 static void AddToReadyList(PtExtend* pt) {
@@ -77,7 +78,7 @@ static void AddToReadyList(PtExtend* pt) {
 }
 
 void RemoveFromWaitListAndAddToReady(PtExtend* pt) {
-    RemoveFromList(waitList, pt);
+    waitWheel.Remove(pt);
     AddToReadyList(pt);
 }
 
@@ -158,27 +159,17 @@ void IdleTask(void*) {
         }
         clearTickCounter = 0;
 
-        t = waitList.head_;
-        while (t) {
+        waitWheel.ForEach([](PtExtend* t) {
             t->taskTicksReal_ = t->taskTicks_;
             t->taskTicks_ = 0;
-            t = t->next_;
-        }
+        });
     }
 #endif
 
-    auto* pt = waitList.head_;
-    while (pt) {
-        auto* next = pt->next_;
-        pt->delay_ -= tickEscape;
-        if (pt->delay_ <= 0) {
-            RemoveFromWaitListAndAddToReady(pt);
-            pt->pt_.status = PT_STATUS_BLOCKED;
-        }
-        pt = next;
-    }
-
-    tickEscape = 0;
+    waitWheel.Advance(tickEscape.exchange(0), [](PtExtend* pt) {
+        AddToReadyList(pt);
+        pt->pt_.status = PT_STATUS_BLOCKED;
+    });
 }
 static PtExtend ptIdle = {
     .taskCode_ = &IdleTask
@@ -193,7 +184,7 @@ uint32_t nestingLevel = 0;
 
 #if PT_EXTEND_ENABLE_PRIORITY
 PtExtend& GetPriotyTask() {
-    if (waitList.head_ == nullptr) {
+    if (waitWheel.Empty()) {
         tickEscape = 0;
     }
     if (tickEscape > 0 || readyList.head_ == nullptr) {
@@ -228,7 +219,7 @@ void RunScheduler() {
 
 void RunSchedulerNoPriority() {
     for (;;) {
-        if (waitList.head_ == nullptr) {
+        if (waitWheel.Empty()) {
             tickEscape = 0;
         }
 
@@ -267,11 +258,9 @@ void PrintTaskTicks() {
         pt = pt->next_;
     }
 
-    pt = waitList.head_;
-    while (pt) {
+    waitWheel.ForEach([](PtExtend* pt) {
         std::cout << std::format("# name: {}, ticks: {}\n", pt->name_, pt->taskTicksReal_);
-        pt = pt->next_;
-    }
+    });
 
     std::cout << "########################################\n";
 }
@@ -18,6 +18,8 @@ struct PtExtend {
 
     pt pt_ = pt_init();
     int32_t delay_{};
+    uint64_t wakeTick_{};
+    uint16_t wheelSlot_{};
 #if PT_EXTEND_COUNT_TASK_TICKS
     uint32_t taskTicks_{}; /* task ticks in 1 second */
     uint32_t taskTicksReal_{};
@@ -1,7 +1,63 @@
 #include "pt_extend2.hpp"
+#include "pt_timer_wheel.hpp"
+#include "pt_mpsc_inbox.hpp"
+#if PT_EXTEND_ENABLE_EDF
+#include "pt_deadline_heap.hpp"
+#endif
+#if PT_EXTEND_STACK_POOL || PT_EXTEND_COROUTINE_FRAME_POOL
+#include "pt_object_pool.hpp"
+#endif
 #include <format>
 #include <iostream>
+#include <algorithm>
 #include <atomic>
+#include <cstdlib>
+#if PT_EXTEND_ENABLE_PRIORITY || PT_EXTEND_TASK_STATS
+#include <bit>
+#endif
+#if PT_EXTEND_TICKLESS_IDLE || PT_EXTEND_TASK_STATS || PT_EXTEND_ENABLE_EDF
+#include <chrono>
+#endif
+#if PT_EXTEND_TICKLESS_IDLE || PT_EXTEND_IO_URING
+#include <condition_variable>
+#endif
+#if PT_EXTEND_TICKLESS_IDLE
+#include <ctime>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#endif
+#endif
+#include <mutex>
+#if PT_EXTEND_EPOLL_REACTOR
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <utility>
+#endif
+#if PT_EXTEND_TIMERFD
+#include <sys/timerfd.h>
+#endif
+#if PT_EXTEND_IO_URING
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <csignal>
+#include <thread>
+#endif
+#if PT_EXTEND_WORK_STEALING
+#include "pt_work_stealing_deque.hpp"
+#include <memory>
+#include <thread>
+#include <vector>
+#endif
 
 namespace pt_extend {
 
@@ -10,314 +66,2518 @@ namespace pt_extend {
 // --------------------------------------------------------------------------------
 void AddToListEnd(RefList& list, PtExtend* pt) {
     pt->prev_ = list.tail_;
-    pt->next_ = nullptr;
-    if (list.tail_) {
-        list.tail_->next_ = pt;
+    pt->next_ = kNoTask;
+    if (list.tail_ != kNoTask) {
+        TaskAt(list.tail_)->next_ = pt->id_;
     } else {
-        list.head_ = pt;
+        list.head_ = pt->id_;
     }
-    list.tail_ = pt;
+    list.tail_ = pt->id_;
 }
 
 void RemoveFromList(RefList& list, PtExtend* pt) {
-    auto* prev = pt->prev_;
-    auto* next = pt->next_;
-    if (prev) {
-        prev->next_ = next;
+    TaskId prev = pt->prev_;
+    TaskId next = pt->next_;
+    if (prev != kNoTask) {
+        TaskAt(prev)->next_ = next;
     } else {
         list.head_ = next;
     }
-    if (next) {
-        next->prev_ = prev;
+    if (next != kNoTask) {
+        TaskAt(next)->prev_ = prev;
     } else {
         list.tail_ = prev;
     }
-    pt->prev_ = nullptr;
-    pt->next_ = nullptr;
+    pt->prev_ = kNoTask;
+    pt->next_ = kNoTask;
 }
 
 PtExtend* PopFront(RefList& list) {
-    if (list.head_) {
-        auto* pt = list.head_;
+    auto* pt = TaskAt(list.head_);
+    if (pt) {
         list.head_ = pt->next_;
-        if (list.head_) {
-            list.head_->prev_ = nullptr;
+        if (list.head_ != kNoTask) {
+            TaskAt(list.head_)->prev_ = kNoTask;
         } else {
-            list.tail_ = nullptr;
+            list.tail_ = kNoTask;
         }
-        pt->next_ = nullptr;
-        pt->prev_ = nullptr;
-        return pt;
+        pt->next_ = kNoTask;
+        pt->prev_ = kNoTask;
     }
-    return nullptr;
+    return pt;
+}
+
+RefList PopFrontN(RefList& list, uint32_t count) {
+    RefList chain = {list.head_, kNoTask};
+    auto* pt = TaskAt(list.head_);
+    PtExtend* tail = nullptr;
+    for (; pt != nullptr && count != 0; count--) {
+        tail = pt;
+        pt = TaskAt(pt->next_);
+    }
+    if (tail == nullptr) {
+        return {};
+    }
+    chain.tail_ = tail->id_;
+    tail->next_ = kNoTask;
+    if (pt) {
+        list.head_ = pt->id_;
+        pt->prev_ = kNoTask;
+    } else {
+        list.head_ = kNoTask;
+        list.tail_ = kNoTask;
+    }
+    return chain;
 }
 
 // --------------------------------------------------------------------------------
-// Detail List
+// Scheduler State
 // --------------------------------------------------------------------------------
-static RefList delayList = {nullptr, nullptr};
-static RefList readyList = {nullptr, nullptr};
-static RefList waitList = {nullptr, nullptr};
-RefList preAwaitList = {nullptr, nullptr};
-void RemoveFromReadyAddToWaitList(PtExtend* pt) {
-    RemoveFromList(readyList, pt);
-    AddToListEnd(delayList, pt);
+using DelayWheel = TimerWheel<TaskCold, &TaskCold::timerNext_, &TaskCold::timerPrev_>;
+void IdleTask(void*);
+
+/* 一个事件循环的全部状态, 只由运行它的线程访问, 标注的除外 */
+struct Scheduler {
+    DelayWheel delayWheel_;
+#if PT_EXTEND_ENABLE_PRIORITY
+    /* 每个优先级一个FIFO, 位图记录非空的优先级 */
+    RefList readyLists_[kPriorityLevels];
+    uint32_t readyBitmap_ = 0;
+#elif !PT_EXTEND_WORK_STEALING
+    RefList readyList_;
+#endif
+#if PT_EXTEND_ENABLE_EDF
+    /* 有截止时间的就绪任务, readyList_里是没有截止时间的 */
+    DeadlineHeap<PtExtend> readyHeap_;
+#endif
+#if PT_EXTEND_STATIC_TASK_SET
+    uint32_t staticReadyCount_ = 0; /* 静态任务集里就绪的任务数 */
+#endif
+    RefList waitList_;
+    /* 以下可以在其他线程访问 */
+    MpscInbox<PtEvent> eventInbox_;
+    MpscInbox<TaskCold> resumeInbox_;
+    std::atomic<uint64_t> tickEscape_ = 0;
+    std::atomic<bool> stop_ = false;
+#if PT_EXTEND_TICKLESS_IDLE
+#if defined(__linux__)
+    std::atomic<uint32_t> idleSeq_ = 0; /* futex字, 每次唤醒加一 */
+#else
+    std::mutex idleMutex_;
+    std::condition_variable idleCond_;
+#endif
+    std::atomic<bool> idleWakeup_ = false;
+    std::atomic<uint32_t> idleSleepers_ = 0;
+    uint64_t lastClockNs_ = 0; /* 已经计入tickEscape_的时钟时间 */
+#endif
+#if !PT_EXTEND_WORK_STEALING
+    PtExtend idle_ = {.taskCode_ = &IdleTask, .scheduler_ = this};
+#endif
+};
+
+#if PT_EXTEND_ENABLE_PRIORITY
+static bool ReadyEmpty(const Scheduler& s) { return s.readyBitmap_ == 0; }
+static uint32_t HighestReadyPriority(const Scheduler& s) { return 31 - std::countl_zero(s.readyBitmap_); }
+#elif PT_EXTEND_ENABLE_EDF
+static bool ReadyEmpty(const Scheduler& s) { return s.readyList_.head_ == kNoTask && s.readyHeap_.Empty(); }
+#elif PT_EXTEND_STATIC_TASK_SET
+static bool ReadyEmpty(const Scheduler& s) { return s.readyList_.head_ == kNoTask && s.staticReadyCount_ == 0; }
+#elif !PT_EXTEND_WORK_STEALING
+static bool ReadyEmpty(const Scheduler& s) { return s.readyList_.head_ == kNoTask; }
+#endif
+
+static thread_local Scheduler* currentScheduler = nullptr;
+
+/* 工作线程(工作窃取/io线程池)分离运行, 所以默认调度器永不析构 */
+Scheduler& DefaultScheduler() {
+    static Scheduler* scheduler = new Scheduler;
+    return *scheduler;
 }
 
-void AddToReadyList(PtExtend* pt) {
-    AddToListEnd(readyList, pt);
+/* 静态初始化时缓存, GiveFromISR/WakeScheduler不经过函数内静态变量的初始化保护 */
+static Scheduler* const defaultScheduler = &DefaultScheduler();
+
+Scheduler& CurrentScheduler() {
+    return currentScheduler ? *currentScheduler : DefaultScheduler();
 }
 
-void RemoveFromWaitListAndAddToReady(PtExtend* pt) {
-    RemoveFromList(delayList, pt);
-    AddToReadyList(pt);
+#if PT_EXTEND_EPOLL_REACTOR || PT_EXTEND_IO_URING
+/* 反应器/io_uring的完成只在默认调度器的SchedulerIdle里分发, 其他调度器的任务在那里等待永远不会被唤醒 */
+static void RequireDefaultScheduler(const PtExtend* pt, std::string_view what) {
+    if (pt->scheduler_ != defaultScheduler) {
+        std::cerr << std::format("pt_extend: {} on a non-default scheduler, task: {}\n", what, TaskColdOf(*pt).name_);
+        std::abort();
+    }
 }
+#endif
 
-void RemoveFromReadyList(PtExtend* pt) {
-    RemoveFromList(readyList, pt);
+void SetCurrentScheduler(Scheduler* scheduler) {
+    currentScheduler = scheduler;
+}
+
+#if !PT_EXTEND_WORK_STEALING
+Scheduler* CreateScheduler() {
+    return new(std::nothrow) Scheduler;
+}
+
+void DestroyScheduler(Scheduler* scheduler) {
+    if (currentScheduler == scheduler) {
+        currentScheduler = nullptr;
+    }
+    delete scheduler;
 }
+#endif
 
 // --------------------------------------------------------------------------------
-// Task
+// Detail List
 // --------------------------------------------------------------------------------
-#if PT_EXTEND_NEST_SUPPORT
-void AddStaticTask(PtExtend& staticTCB, std::string_view name, void (*code)(void* userData), pt* ptCallStack, void* userData) {
-    staticTCB.taskCode_ = code;
-    staticTCB.userData_ = userData;
-    staticTCB.flags.dynamic = 0;
-    staticTCB.flags.dynamicStack = 0;
-    staticTCB.name_ = name;
-    staticTCB.ptCallStack = ptCallStack;
-    AddToReadyList(&staticTCB);
+void RemoveFromReadyAddToWaitList(PtExtend* pt, int64_t ticks) {
+    RemoveFromReadyList(pt);
+    pt_extend_disable_irq();
+    pt->scheduler_->delayWheel_.Add(&TaskColdOf(*pt), ticks);
+    pt_extend_enable_irq();
 }
 
-#if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
-PtExtend* AddDynamicTask(std::string_view name, void (*code)(void* userData), pt* ptCallStack, void* userData) {
-    auto* pt = new(std::nothrow) PtExtend;
-    if (!pt) {
-        return nullptr;
-    }
-    pt->taskCode_ = code;
-    pt->userData_ = userData;
-    pt->flags.dynamic = 1;
-    pt->flags.dynamicStack = 0;
-    pt->name_ = name;
-    pt->ptCallStack = ptCallStack;
+void RemoveFromWaitListAndAddToReady(PtExtend* pt) {
+    pt_extend_disable_irq();
+    pt->scheduler_->delayWheel_.Remove(&TaskColdOf(*pt));
+    pt_extend_enable_irq();
     AddToReadyList(pt);
-    return pt;
 }
 
-PtExtend* AddDynamicTask(std::string_view name, void (*code)(void *userData), uint32_t stackDepth, void *userData) {
-    auto* stack = new(std::nothrow) pt[stackDepth];
-    if (stack == nullptr) {
-        return nullptr;
-    }
-    for (uint32_t i = 0; i < stackDepth; i++) {
-        stack[i] = pt_init();
-    }
+/* 工作窃取模式的就绪队列在Work Stealing一节 */
+#if PT_EXTEND_ENABLE_PRIORITY
+void AddToReadyList(PtExtend* pt) {
+    auto& s = *pt->scheduler_;
+    AddToListEnd(s.readyLists_[pt->priority_], pt);
+    s.readyBitmap_ |= 1u << pt->priority_;
+    pt->flags.ready = 1;
+}
 
-    auto* pt = AddDynamicTask(name, code, stack, userData);
-    if (pt == nullptr) {
-        delete[] stack;
-        return nullptr;
+void RemoveFromReadyList(PtExtend* pt) {
+    auto& s = *pt->scheduler_;
+    auto& list = s.readyLists_[pt->priority_];
+    RemoveFromList(list, pt);
+    if (list.head_ == kNoTask) {
+        s.readyBitmap_ &= ~(1u << pt->priority_);
     }
-    pt->flags.dynamicStack = 1;
-    return pt;
+    pt->flags.ready = 0;
 }
 
-#endif
-#else
-void AddStaticTask(PtExtend& staticTCB, std::string_view name, void (*code)(void* userData), void* userData) {
-    staticTCB.taskCode_ = code;
-    staticTCB.userData_ = userData;
-    staticTCB.flags.dynamic = 0;
-    staticTCB.name_ = name;
-    AddToReadyList(&staticTCB);
+void SetTaskPriority(PtExtend& pt, uint32_t priority) {
+    if (priority >= kPriorityLevels) {
+        priority = kPriorityLevels - 1;
+    }
+    if (pt.flags.ready) {
+        RemoveFromReadyList(&pt);
+        pt.priority_ = static_cast<uint8_t>(priority);
+        AddToReadyList(&pt);
+    } else {
+        pt.priority_ = static_cast<uint8_t>(priority);
+    }
+}
+#elif PT_EXTEND_ENABLE_EDF
+static uint64_t EdfNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
 }
 
-#if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
-PtExtend* AddDynamicTask(std::string_view name, void (*code)(void* userData), void* userData) {
-    auto* pt = new(std::nothrow) PtExtend;
-    if (!pt) {
-        return nullptr;
+/* 变为就绪时开始新的截止时间, 已经就绪的不变 */
+void AddToReadyList(PtExtend* pt) {
+    if (pt->flags.ready) {
+        return;
     }
-    pt->taskCode_ = code;
-    pt->userData_ = userData;
-    pt->flags.dynamic = 1;
-    pt->name_ = name;
-    AddToReadyList(pt);
-    return pt;
+    auto& s = *pt->scheduler_;
+    if (pt->relativeDeadlineUs_ != 0) {
+        pt->deadline_ = EdfNow() + uint64_t{pt->relativeDeadlineUs_} * 1000;
+        s.readyHeap_.Push(pt);
+    } else {
+        AddToListEnd(s.readyList_, pt);
+    }
+    pt->flags.ready = 1;
 }
-#endif
-#endif
 
-void SuspendTask(PtExtend& pt) {
-    RemoveFromReadyList(&pt);
-    AddToListEnd(waitList, &pt);
+static void RemoveFromReadyStructure(PtExtend* pt) {
+    auto& s = *pt->scheduler_;
+    if (pt->relativeDeadlineUs_ != 0) {
+        s.readyHeap_.Remove(pt);
+    } else {
+        RemoveFromList(s.readyList_, pt);
+    }
+    pt->flags.ready = 0;
 }
 
-void ResumeTask(PtExtend& pt) {
-    RemoveFromList(waitList, &pt);
-    AddToReadyList(&pt);
+/* 离开就绪状态即本次就绪完成, 晚于截止时间算一次错过 */
+void RemoveFromReadyList(PtExtend* pt) {
+    if (!pt->flags.ready) {
+        return;
+    }
+    if (pt->relativeDeadlineUs_ != 0 && EdfNow() > pt->deadline_) {
+        TaskColdOf(*pt).deadlineMisses_.fetch_add(1, std::memory_order_relaxed);
+    }
+    RemoveFromReadyStructure(pt);
 }
 
-// --------------------------------------------------------------------------------
-// Delay
-// --------------------------------------------------------------------------------
-static std::atomic<uint32_t> tickEscape = 0;
-void TimerTick(uint32_t tickPlus) {
-    tickEscape += tickPlus;
+/* 已经就绪的任务按新的相对截止时间重新开始计时 */
+void SetTaskDeadline(PtExtend& pt, uint32_t relativeDeadlineUs) {
+    if (pt.flags.ready) {
+        RemoveFromReadyStructure(&pt);
+        pt.relativeDeadlineUs_ = relativeDeadlineUs;
+        AddToReadyList(&pt);
+    } else {
+        pt.relativeDeadlineUs_ = relativeDeadlineUs;
+    }
 }
-
-// --------------------------------------------------------------------------------
-// Idle
-// --------------------------------------------------------------------------------
-#if PT_EXTEND_COUNT_TASK_TICKS
-static constexpr uint32_t kTicksPerSecond = Ms2Ticks(1000);
-uint32_t clearTickCounter = 0;
-#endif
-void IdleTask(void*) {
-    if (tickEscape <= 0) {
+#elif !PT_EXTEND_WORK_STEALING
+void AddToReadyList(PtExtend* pt) {
+    auto& s = *pt->scheduler_;
+#if PT_EXTEND_STATIC_TASK_SET
+    if (pt->flags.staticSet) {
+        s.staticReadyCount_ += !pt->flags.ready;
+        pt->flags.ready = 1;
         return;
     }
+#endif
+    AddToListEnd(s.readyList_, pt);
+}
 
-#if PT_EXTEND_COUNT_TASK_TICKS
-    clearTickCounter += tickEscape;
-    if (clearTickCounter >= kTicksPerSecond) {
-        auto* t = readyList.head_;
-        while (t) {
-            t->taskTicksReal_ = t->taskTicks_;
-            t->taskTicks_ = 0;
-            t = t->next_;
-        }
-        clearTickCounter = 0;
-
-        t = delayList.head_;
-        while (t) {
-            t->taskTicksReal_ = t->taskTicks_;
-            t->taskTicks_ = 0;
-            t = t->next_;
-        }
+void RemoveFromReadyList(PtExtend* pt) {
+    auto& s = *pt->scheduler_;
+#if PT_EXTEND_STATIC_TASK_SET
+    if (pt->flags.staticSet) {
+        s.staticReadyCount_ -= pt->flags.ready;
+        pt->flags.ready = 0;
+        return;
     }
+#endif
+    RemoveFromList(s.readyList_, pt);
+}
 #endif
 
-    auto* pt = delayList.head_;
+/* 把PopFrontN取下的一串任务放回就绪队列, 单就绪队列时整串拼接. 一个事件的等待者属于同一个调度器 */
+static void AddChainToReadyList(RefList chain) {
+#if !PT_EXTEND_ENABLE_PRIORITY && !PT_EXTEND_ENABLE_EDF && !PT_EXTEND_WORK_STEALING && !PT_EXTEND_STATIC_TASK_SET
+    auto* head = TaskAt(chain.head_);
+    if (head == nullptr) {
+        return;
+    }
+    auto& readyList = head->scheduler_->readyList_;
+    head->prev_ = readyList.tail_;
+    if (readyList.tail_ != kNoTask) {
+        TaskAt(readyList.tail_)->next_ = chain.head_;
+    } else {
+        readyList.head_ = chain.head_;
+    }
+    readyList.tail_ = chain.tail_;
+#else
+    auto* pt = TaskAt(chain.head_);
     while (pt) {
-        auto* next = pt->next_;
-        pt->delay_ -= tickEscape;
-        if (pt->delay_ <= 0) {
-            RemoveFromWaitListAndAddToReady(pt);
-            pt->pt_.status = PT_STATUS_BLOCKED;
-        }
+        auto* next = TaskAt(pt->next_);
+        AddToReadyList(pt);
         pt = next;
     }
-
-    tickEscape = 0;
+#endif
 }
-static PtExtend ptIdle = {
-    .taskCode_ = &IdleTask
-};
 
 // --------------------------------------------------------------------------------
-// Scheduler
+// Task Table
 // --------------------------------------------------------------------------------
-static PtExtend* pCurrentTask = nullptr;
-uint32_t nestingLevel = 0;
+TaskChunk* taskChunks[kTaskTableMaxChunks];
+StaticTaskChunk* staticTaskChunks[kStaticTaskMaxChunks];
 
-PtExtend *GetCurrentTask() {
-    return pCurrentTask;
+/* 追加块/空闲链表/静态任务登记 */
+static std::mutex taskTableMutex;
+static uint32_t staticTaskCount = 0;
+static TaskId freeStaticHead = kNoTask; /* 结束的静态任务归还的下标, 经冷数据的id_链接 */
+
+[[noreturn]] static void StaticTaskTableFull(std::string_view name) {
+    std::cerr << std::format("pt_extend: static task table full, task: {}\n", name);
+    std::abort();
+}
+
+static StaticTaskChunk& StaticChunkOf(TaskId id) {
+    return *staticTaskChunks[(id & ~kStaticTaskBit) >> kStaticTaskChunkBits];
+}
+
+/* 静态TCB添加时分配下标, 已经有下标(还没结束)时沿用. 优先复用归还的下标, 冷数据重新构造 */
+static void RegisterStaticTask(PtExtend& pt, std::string_view name) {
+    if (pt.id_ != kNoTask) {
+        return;
+    }
+    std::lock_guard lock{taskTableMutex};
+    TaskId id = freeStaticHead;
+    if (id != kNoTask) {
+        freeStaticHead = StaticChunkOf(id).cold_[id & kStaticTaskChunkMask].id_;
+    } else {
+        uint32_t chunkIndex = staticTaskCount >> kStaticTaskChunkBits;
+        if (chunkIndex == kStaticTaskMaxChunks) {
+            StaticTaskTableFull(name);
+        }
+        if (staticTaskChunks[chunkIndex] == nullptr) {
+            staticTaskChunks[chunkIndex] = new(std::nothrow) StaticTaskChunk;
+            if (staticTaskChunks[chunkIndex] == nullptr) {
+                StaticTaskTableFull(name);
+            }
+        }
+        id = kStaticTaskBit | staticTaskCount++;
+    }
+    auto& chunk = StaticChunkOf(id);
+    pt.id_ = id;
+    chunk.hot_[id & kStaticTaskChunkMask] = &pt;
+    auto* cold = ::new (&chunk.cold_[id & kStaticTaskChunkMask]) TaskCold();
+    cold->id_ = id;
+}
+
+/* 静态任务结束时归还下标, TCB之后可以释放或重新添加 */
+static void UnregisterStaticTask(PtExtend& pt) {
+    std::lock_guard lock{taskTableMutex};
+    auto& chunk = StaticChunkOf(pt.id_);
+    chunk.hot_[pt.id_ & kStaticTaskChunkMask] = nullptr;
+    chunk.cold_[pt.id_ & kStaticTaskChunkMask].id_ = freeStaticHead;
+    freeStaticHead = pt.id_;
+    pt.id_ = kNoTask;
 }
 
 #if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
-void DynamicDeleteCurrent() {
-    #if PT_EXTEND_NEST_SUPPORT
-    if (pCurrentTask->flags.dynamicStack) {
-        delete pCurrentTask->ptCallStack;
+static uint32_t taskChunkCount = 0;
+static TaskId freeTaskHead = kNoTask; /* 空闲的动态任务, 经next_链接 */
+static uint32_t freeTaskCount = 0;
+
+/* 以下持有taskTableMutex时调用 */
+
+/* 新块的下标按递增顺序放在空闲链表前面 */
+static bool GrowTaskTable() {
+    if (taskChunkCount == kTaskTableMaxChunks) {
+        return false;
     }
-    #endif
-    delete pCurrentTask;
-    pCurrentTask = nullptr;
+    auto* chunk = new(std::nothrow) TaskChunk;
+    if (chunk == nullptr) {
+        return false;
+    }
+    TaskId base = taskChunkCount << kTaskChunkBits;
+    for (uint32_t i = kTaskChunkSize; i-- > 0;) {
+        chunk->hot_[i].next_ = freeTaskHead;
+        freeTaskHead = base + i;
+    }
+    taskChunks[taskChunkCount++] = chunk;
+    freeTaskCount += kTaskChunkSize;
+    return true;
+}
+
+/* 没有空闲且无法扩展时返回kNoTask */
+static TaskId PopFreeTask() {
+    if (freeTaskHead == kNoTask && !GrowTaskTable()) {
+        return kNoTask;
+    }
+    TaskId id = freeTaskHead;
+    freeTaskHead = TaskAt(id)->next_;
+    --freeTaskCount;
+    return id;
 }
-#endif
 
-void SetCurrentTask(PtExtend& pt) {
-    pCurrentTask = &pt;
+static void PushFreeTask(TaskId id) {
+    TaskAt(id)->next_ = freeTaskHead;
+    freeTaskHead = id;
+    ++freeTaskCount;
 }
 
-void RunSchedulerNoPriority() {
-    for (;;) {
-        if (delayList.head_ == nullptr) {
-            tickEscape = 0;
-        }
+/* 重新构造下标处的热数据和冷数据 */
+static PtExtend* InitTask(TaskId id) {
+    auto& chunk = *taskChunks[id >> kTaskChunkBits];
+    auto* pt = ::new (&chunk.hot_[id & kTaskChunkMask]) PtExtend();
+    auto* cold = ::new (&chunk.cold_[id & kTaskChunkMask]) TaskCold();
+    pt->id_ = id;
+    cold->id_ = id;
+    return pt;
+}
+
+#if PT_EXTEND_TCB_POOL
+/* 调度器可能在多个线程上运行, 每个线程缓存一部分空闲下标, 批量和全局空闲链表交换 */
+struct TaskPoolCache {
+    TaskId slots[kTaskPoolCacheSize];
+    uint32_t count = 0;
 
-        if (tickEscape > 0 || readyList.head_ == nullptr) {
-            pCurrentTask = &ptIdle;
-            ptIdle.taskCode_(nullptr);
+    ~TaskPoolCache() {
+        std::lock_guard lock{taskTableMutex};
+        while (count != 0) {
+            PushFreeTask(slots[--count]);
         }
+    }
+};
+static thread_local TaskPoolCache taskPoolCache;
 
-        /* add all pre await to ready end */
-        pt_extend_disable_irq();
-        if (preAwaitList.head_ != nullptr) {
-            if (readyList.tail_) {
-                readyList.tail_->next_ = preAwaitList.head_;
-                preAwaitList.head_->prev_ = readyList.tail_;
+/* 新块的空闲链表按下标递增, 反过来放进缓存使弹出的顺序也是递增的:
+ * 连续创建的任务在就绪队列里的顺序和内存顺序一致, 遍历时是顺序访问, 可以被硬件预取 */
+static PtExtend* NewTask() {
+    auto& cache = taskPoolCache;
+    if (cache.count == 0) {
+        std::lock_guard lock{taskTableMutex};
+        while (cache.count < kTaskPoolCacheSize / 2) {
+            TaskId id = PopFreeTask();
+            if (id == kNoTask) {
+                break;
             }
-            else {
-                readyList.head_ = preAwaitList.head_;
-            }
-            readyList.tail_ = preAwaitList.tail_;
-            preAwaitList.head_ = nullptr;
-            preAwaitList.tail_ = nullptr;
+            cache.slots[cache.count++] = id;
         }
-        pt_extend_enable_irq();
+        if (cache.count == 0) {
+            return nullptr;
+        }
+        std::reverse(cache.slots, cache.slots + cache.count);
+    }
+    return InitTask(cache.slots[--cache.count]);
+}
 
-        pCurrentTask = readyList.head_;
-        while (pCurrentTask) {
-            auto* next = pCurrentTask->next_;
-#if PT_EXTEND_COUNT_TASK_TICKS
-            uint32_t tickBegin = tickEscape;
-#endif
-            pCurrentTask->taskCode_(pCurrentTask->userData_);
-#if PT_EXTEND_COUNT_TASK_TICKS
-            uint32_t tickEnd = tickEscape;
-            if (pCurrentTask != nullptr) {
-                pCurrentTask->taskTicks_ += tickEnd - tickBegin;
-            }
-#endif
-            pCurrentTask = next;
+static void DeleteTask(PtExtend* pt) {
+    auto& cache = taskPoolCache;
+    if (cache.count == kTaskPoolCacheSize) {
+        std::lock_guard lock{taskTableMutex};
+        while (cache.count > kTaskPoolCacheSize / 2) {
+            PushFreeTask(cache.slots[--cache.count]);
         }
     }
+    cache.slots[cache.count++] = pt->id_;
 }
 
-#if PT_EXTEND_COUNT_TASK_TICKS
-void PrintTaskTicks() {
-    std::cout << "########################################\n";
+bool ReserveTaskPool(uint32_t count) {
+    std::lock_guard lock{taskTableMutex};
+    while (freeTaskCount < count) {
+        if (!GrowTaskTable()) {
+            return false;
+        }
+    }
+    return true;
+}
+#else
+static PtExtend* NewTask() {
+    TaskId id;
+    {
+        std::lock_guard lock{taskTableMutex};
+        id = PopFreeTask();
+    }
+    return id == kNoTask ? nullptr : InitTask(id);
+}
 
-    auto* pt = readyList.head_;
-    while (pt) {
-        std::cout << std::format("# name: {}, ticks: {}\n", pt->name_, pt->taskTicksReal_);
-        pt = pt->next_;
+static void DeleteTask(PtExtend* pt) {
+    std::lock_guard lock{taskTableMutex};
+    PushFreeTask(pt->id_);
+}
+#endif
+#endif
+
+// --------------------------------------------------------------------------------
+// Stack Pool
+// --------------------------------------------------------------------------------
+#if PT_EXTEND_ENABLE_DYNAMIC_ALLOC && PT_EXTEND_NEST_SUPPORT
+#if PT_EXTEND_STACK_POOL
+using StackPool = SizeClassPool<pt, kStackPoolClasses>;
+static StackPool stackPool{kStackPoolChunk};
+static std::mutex stackPoolMutex;
+
+/* 返回的栈不初始化, pt_extend_call_begin进入时才初始化对应栈帧 */
+static pt* NewStack(uint32_t& depth) {
+    uint32_t rounded = StackPool::RoundCount(depth);
+    if (rounded == 0) {
+        return new(std::nothrow) pt[depth];
     }
+    depth = rounded;
+    std::lock_guard lock{stackPoolMutex};
+    return stackPool.Allocate(rounded);
+}
 
-    pt = delayList.head_;
-    while (pt) {
-        std::cout << std::format("# name: {}, ticks: {}\n", pt->name_, pt->taskTicksReal_);
-        pt = pt->next_;
+static void DeleteStack(pt* stack, uint32_t depth) {
+    if (depth > StackPool::kMaxCount) {
+        delete[] stack;
+        return;
     }
+    std::lock_guard lock{stackPoolMutex};
+    stackPool.Free(stack, depth);
+}
+#else
+static pt* NewStack(uint32_t& depth) {
+    return new(std::nothrow) pt[depth];
+}
 
-    std::cout << "########################################\n";
+static void DeleteStack(pt* stack, uint32_t) {
+    delete[] stack;
 }
 #endif
+#endif
 
-pt* GetCurrentCallPt() {
+// --------------------------------------------------------------------------------
+// Call Stack
+// --------------------------------------------------------------------------------
 #if PT_EXTEND_NEST_SUPPORT
-    if (nestingLevel == 0) {
-        return &pCurrentTask->pt_;
+#if PT_EXTEND_CALL_STACK_TRAP
+[[noreturn]] static void CallStackOverflow(const PtExtend& task) {
+    auto& cold = TaskColdOf(task);
+    std::cerr << std::format("pt_extend: call stack overflow, task: {}, depth: {}\n", cold.name_, cold.stackDepth_);
+    __builtin_trap();
+}
+#endif
+
+void ReleaseCallStack(PtExtend& pt) {
+#if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
+    if (pt.flags.dynamicStack) {
+        auto& cold = TaskColdOf(pt);
+        DeleteStack(cold.ptCallStack, cold.stackDepth_);
+        pt.flags.dynamicStack = 0;
+        cold.ptCallStack = nullptr;
+        cold.stackDepth_ = 0;
+    }
+#else
+    (void)pt;
+#endif
+}
+
+/* 栈帧只有label和状态, 没有指向栈内的指针, 整体复制到新栈后只需要重新指向当前栈帧 */
+bool GrowCallStack() {
+#if PT_EXTEND_CALL_STACK_GROW
+    auto& task = *pCurrentTask;
+    auto& cold = TaskColdOf(task);
+    uint32_t depth = std::max(cold.stackDepth_ * 2, kCallStackMinDepth);
+    auto* stack = NewStack(depth);
+    if (stack != nullptr) {
+        std::copy_n(cold.ptCallStack, nestingLevel, stack);
+        ReleaseCallStack(task);
+        cold.ptCallStack = stack;
+        cold.stackDepth_ = depth;
+        task.flags.dynamicStack = 1;
+        if (nestingLevel != 0) {
+            pCurrentCallPt = &stack[nestingLevel - 1];
+        }
+        return true;
+    }
+#endif
+#if PT_EXTEND_CALL_STACK_TRAP
+    CallStackOverflow(*pCurrentTask);
+#else
+    return false;
+#endif
+}
+#endif
+
+// --------------------------------------------------------------------------------
+// Coroutine Frame Pool
+// --------------------------------------------------------------------------------
+#if PT_EXTEND_COROUTINE_FRAME_POOL
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) FrameBlock {
+    unsigned char bytes[kFramePoolBlockSize];
+};
+using FramePool = SizeClassPool<FrameBlock, kFramePoolClasses>;
+static FramePool framePool{kFramePoolChunk};
+static std::mutex framePoolMutex;
+
+static uint32_t FrameBlocks(size_t size) {
+    size_t blocks = (size + kFramePoolBlockSize - 1) / kFramePoolBlockSize;
+    return blocks > FramePool::kMaxCount ? 0 : FramePool::RoundCount(static_cast<uint32_t>(blocks));
+}
+
+void* AllocateCoroutineFrame(size_t size) {
+    uint32_t blocks = FrameBlocks(size);
+    if (blocks == 0) {
+        return ::operator new(size, std::nothrow);
+    }
+    std::lock_guard lock{framePoolMutex};
+    return framePool.Allocate(blocks);
+}
+
+void FreeCoroutineFrame(void* frame, size_t size) {
+    uint32_t blocks = FrameBlocks(size);
+    if (blocks == 0) {
+        ::operator delete(frame);
+        return;
     }
-    return &pCurrentTask->ptCallStack[nestingLevel - 1];
+    std::lock_guard lock{framePoolMutex};
+    framePool.Free(static_cast<FrameBlock*>(frame), blocks);
+}
 #else
-    return &pCurrentTask->pt_;
+void* AllocateCoroutineFrame(size_t size) {
+    return ::operator new(size, std::nothrow);
+}
+
+void FreeCoroutineFrame(void* frame, size_t) {
+    ::operator delete(frame);
+}
 #endif
+
+// --------------------------------------------------------------------------------
+// Task Stats
+// --------------------------------------------------------------------------------
+#if PT_EXTEND_TASK_STATS
+static std::mutex statsMutex;
+static PtExtend* statsHead = nullptr;
+
+static TaskStats& StatsOf(const PtExtend* pt) {
+    return TaskColdOf(*pt).stats_;
+}
+
+/* 已经在链表里时不重复加入, 否则形成环 */
+static bool StatsRegistered(const PtExtend* pt) {
+    return statsHead == pt || StatsOf(pt).registryPrev_ != nullptr;
 }
 
+static void RegisterStats(PtExtend* pt) {
+    std::lock_guard lock{statsMutex};
+    if (StatsRegistered(pt)) {
+        return;
+    }
+    StatsOf(pt).registryPrev_ = nullptr;
+    StatsOf(pt).registryNext_ = statsHead;
+    if (statsHead) {
+        StatsOf(statsHead).registryPrev_ = pt;
+    }
+    statsHead = pt;
+}
+
+static void UnregisterStats(PtExtend* pt) {
+    std::lock_guard lock{statsMutex};
+    if (!StatsRegistered(pt)) {
+        return;
+    }
+    auto* prev = StatsOf(pt).registryPrev_;
+    auto* next = StatsOf(pt).registryNext_;
+    if (prev) {
+        StatsOf(prev).registryNext_ = next;
+    } else {
+        statsHead = next;
+    }
+    if (next) {
+        StatsOf(next).registryPrev_ = prev;
+    }
+    StatsOf(pt).registryPrev_ = nullptr;
+    StatsOf(pt).registryNext_ = nullptr;
+}
+
+static uint64_t StatsNow() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/* 单写者, 不需要RMW */
+static void RecordResume(TaskStats& stats, uint64_t ns) {
+    uint32_t seq = stats.seq_.load(std::memory_order_relaxed);
+    stats.seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    stats.cpuNs_.store(stats.cpuNs_.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    stats.resumes_.store(stats.resumes_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (ns > stats.maxNs_.load(std::memory_order_relaxed)) {
+        stats.maxNs_.store(ns, std::memory_order_relaxed);
+    }
+    uint32_t bucket = static_cast<uint32_t>(std::bit_width(ns));
+    if (bucket >= kTaskStatsBuckets) {
+        bucket = kTaskStatsBuckets - 1;
+    }
+    auto& count = stats.histogram_[bucket];
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    stats.seq_.store(seq + 2, std::memory_order_release);
+}
+
+/* 读到写了一半的数据就重读 */
+static void ReadStats(const PtExtend* pt, TaskStatsSnapshot& out) {
+    const auto& stats = StatsOf(pt);
+    out.name_ = TaskColdOf(*pt).name_;
+    for (;;) {
+        uint32_t seq = stats.seq_.load(std::memory_order_acquire);
+        if (seq & 1) {
+            continue;
+        }
+        out.cpuNs_ = stats.cpuNs_.load(std::memory_order_relaxed);
+        out.resumes_ = stats.resumes_.load(std::memory_order_relaxed);
+        out.maxNs_ = stats.maxNs_.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < kTaskStatsBuckets; i++) {
+            out.histogram_[i] = stats.histogram_[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (stats.seq_.load(std::memory_order_relaxed) == seq) {
+            return;
+        }
+    }
+}
+
+std::vector<TaskStatsSnapshot> SnapshotTaskStats() {
+    std::vector<TaskStatsSnapshot> result;
+    std::lock_guard lock{statsMutex};
+    for (auto* pt = statsHead; pt; pt = StatsOf(pt).registryNext_) {
+        ReadStats(pt, result.emplace_back());
+    }
+    return result;
+}
+
+#if PT_EXTEND_STATIC_TASK_SET
+uint64_t TaskStatsNow() {
+    return StatsNow();
+}
+
+void RecordTaskResume(PtExtend& pt, uint64_t ns) {
+    if (pt.id_ != kNoTask) {
+        RecordResume(StatsOf(&pt), ns);
+    }
+}
+#endif
+#endif
+
+// --------------------------------------------------------------------------------
+// Task
+// --------------------------------------------------------------------------------
+#if PT_EXTEND_NEST_SUPPORT
+void AddStaticTask(PtExtend& staticTCB, std::string_view name, void (*code)(void* userData), pt* ptCallStack, uint32_t stackDepth, void* userData) {
+    RegisterStaticTask(staticTCB, name);
+    auto& cold = TaskColdOf(staticTCB);
+    staticTCB.taskCode_ = code;
+    TaskUserData(staticTCB) = userData;
+    staticTCB.flags.dynamic = 0;
+    staticTCB.flags.dynamicStack = 0;
+#if PT_EXTEND_ENABLE_PRIORITY || PT_EXTEND_ENABLE_EDF || PT_EXTEND_STATIC_TASK_SET
+    staticTCB.flags.ready = 0; /* 不能沿用TCB里的旧值, 否则AddToReadyList当作已经就绪 */
+#endif
+    cold.name_ = name;
+    cold.ptCallStack = ptCallStack;
+    cold.stackDepth_ = stackDepth;
+    cold.stackHighWater_.store(0, std::memory_order_relaxed);
+    staticTCB.scheduler_ = &CurrentScheduler();
+#if PT_EXTEND_TASK_STATS
+    RegisterStats(&staticTCB);
+#endif
+    AddToReadyList(&staticTCB);
+}
+
+void AddStaticTask(PtExtend& staticTCB, std::string_view name, void (*code)(void* userData), void* userData) {
+    AddStaticTask(staticTCB, name, code, nullptr, 0, userData);
+}
+#else
+void AddStaticTask(PtExtend& staticTCB, std::string_view name, void (*code)(void* userData), void* userData) {
+    RegisterStaticTask(staticTCB, name);
+    staticTCB.taskCode_ = code;
+    TaskUserData(staticTCB) = userData;
+    staticTCB.flags.dynamic = 0;
+    staticTCB.flags.dynamicStack = 0;
+#if PT_EXTEND_ENABLE_PRIORITY || PT_EXTEND_ENABLE_EDF || PT_EXTEND_STATIC_TASK_SET
+    staticTCB.flags.ready = 0; /* 不能沿用TCB里的旧值, 否则AddToReadyList当作已经就绪 */
+#endif
+    TaskColdOf(staticTCB).name_ = name;
+    staticTCB.scheduler_ = &CurrentScheduler();
+#if PT_EXTEND_TASK_STATS
+    RegisterStats(&staticTCB);
+#endif
+    AddToReadyList(&staticTCB);
+}
+#endif
+
+#if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
+/* 创建但还不放进就绪队列, 调用者设置完其他字段再放入, 工作窃取时任务可能马上在别的worker上运行 */
+static PtExtend* NewDynamicTask(std::string_view name, void (*code)(void* userData), void* userData) {
+    auto* pt = NewTask();
+    if (!pt) {
+        return nullptr;
+    }
+    pt->taskCode_ = code;
+    TaskUserData(*pt) = userData;
+    pt->flags.dynamic = 1;
+    pt->flags.dynamicStack = 0;
+#if PT_EXTEND_STATIC_TASK_SET
+    pt->flags.staticSet = 0;
+#endif
+#if PT_EXTEND_ENABLE_PRIORITY || PT_EXTEND_ENABLE_EDF || PT_EXTEND_STATIC_TASK_SET
+    pt->flags.ready = 0;
+#endif
+    TaskColdOf(*pt).name_ = name;
+    pt->scheduler_ = &CurrentScheduler();
+#if PT_EXTEND_TASK_STATS
+    RegisterStats(pt);
+#endif
+    return pt;
+}
+
+#if PT_EXTEND_NEST_SUPPORT
+/* stackDepth不为0时预先从栈池分配调用栈 */
+static PtExtend* NewDynamicTask(std::string_view name, void (*code)(void* userData), uint32_t stackDepth, void* userData) {
+    if (stackDepth == 0) {
+        return NewDynamicTask(name, code, userData);
+    }
+    auto* stack = NewStack(stackDepth);
+    if (stack == nullptr) {
+        return nullptr;
+    }
+
+    auto* pt = NewDynamicTask(name, code, userData);
+    if (pt == nullptr) {
+        DeleteStack(stack, stackDepth);
+        return nullptr;
+    }
+    TaskColdOf(*pt).ptCallStack = stack;
+    TaskColdOf(*pt).stackDepth_ = stackDepth;
+    pt->flags.dynamicStack = 1;
+    return pt;
+}
+#endif
+
+PtExtend* AddDynamicTask(std::string_view name, void (*code)(void* userData), void* userData) {
+    auto* pt = NewDynamicTask(name, code, userData);
+    if (pt) {
+        AddToReadyList(pt);
+    }
+    return pt;
+}
+
+#if PT_EXTEND_NEST_SUPPORT
+PtExtend* AddDynamicTask(std::string_view name, void (*code)(void* userData), pt* ptCallStack, uint32_t stackDepth, void* userData) {
+    auto* pt = NewDynamicTask(name, code, userData);
+    if (pt) {
+        TaskColdOf(*pt).ptCallStack = ptCallStack;
+        TaskColdOf(*pt).stackDepth_ = stackDepth;
+        AddToReadyList(pt);
+    }
+    return pt;
+}
+
+PtExtend* AddDynamicTask(std::string_view name, void (*code)(void *userData), uint32_t stackDepth, void *userData) {
+    auto* pt = NewDynamicTask(name, code, stackDepth, userData);
+    if (pt) {
+        AddToReadyList(pt);
+    }
+    return pt;
+}
+#endif
+#endif
+
+// --------------------------------------------------------------------------------
+// Task Group
+// --------------------------------------------------------------------------------
+#if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
+/* 在放进就绪队列之前加入组, 子任务最早也要在这之后才能退出 */
+static PtExtend* EnterGroup(TaskGroup& group, PtExtend* pt) {
+    if (pt == nullptr) {
+        return nullptr;
+    }
+    TaskColdOf(*pt).group_ = &group;
+    group.live_.fetch_add(1, std::memory_order_relaxed);
+    pt_extend_disable_irq();
+    ++group.members_;
+    pt_extend_enable_irq();
+    AddToReadyList(pt);
+    return pt;
+}
+
+PtExtend* TaskGroup::Spawn(std::string_view name, void (*code)(void* userData), void* userData) {
+    return EnterGroup(*this, NewDynamicTask(name, code, userData));
+}
+
+#if PT_EXTEND_NEST_SUPPORT
+PtExtend* TaskGroup::Spawn(std::string_view name, void (*code)(void* userData), uint32_t stackDepth, void* userData) {
+    return EnterGroup(*this, NewDynamicTask(name, code, stackDepth, userData));
+}
+#endif
+
+/* 在临界区内调用: 组已封闭且所有成员都已到达(或退出)时结束本阶段, 返回要唤醒的到达者数和它们等待的事件 */
+static uint32_t ClosePhase(TaskGroup& group, PtEvent*& e) {
+    uint32_t phase = group.phase_.load(std::memory_order_relaxed);
+    e = &group.barrier_[phase & 1];
+    if (!group.sealed_ || group.arrived_ == 0 || group.arrived_ < group.members_) {
+        return 0;
+    }
+    uint32_t arrived = group.arrived_;
+    group.arrived_ = 0;
+    group.phase_.store(phase + 1, std::memory_order_release);
+    return arrived;
+}
+
+/* 只剩父任务持有的1时说明全部退出, 否则等最后一个子任务Give */
+bool TaskGroup::JoinOrPark() {
+    PtEvent* e;
+    pt_extend_disable_irq();
+    sealed_ = members_ != 0;
+    uint32_t release = ClosePhase(*this, e);
+    pt_extend_enable_irq();
+    e->GiveN(release);
+
+    if (live_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        live_.store(1, std::memory_order_relaxed);
+        return false;
+    }
+    return !done_.TryTake() && done_.TakeOrPark();
+}
+
+bool TaskGroup::ArriveOrPark() {
+    PtEvent* e;
+    pt_extend_disable_irq();
+    ++arrived_;
+    uint32_t release = ClosePhase(*this, e);
+    pt_extend_enable_irq();
+
+    /* 自己是最后一个到达的, 不需要等待 */
+    if (release != 0) {
+        e->GiveN(release - 1);
+        return false;
+    }
+    return !e->TryTake() && e->TakeOrPark();
+}
+
+/* 退出的子任务可能是本阶段最后一个没到达的 */
+void TaskGroup::Leave() {
+    PtEvent* e;
+    pt_extend_disable_irq();
+    if (--members_ == 0) {
+        sealed_ = false;
+    }
+    uint32_t release = ClosePhase(*this, e);
+    pt_extend_enable_irq();
+    e->GiveN(release);
+
+    if (live_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        live_.store(1, std::memory_order_relaxed);
+        done_.Give();
+    }
+}
+#endif
+
+void SuspendTask(PtExtend& pt) {
+    auto& cold = TaskColdOf(pt);
+    if (cold.suspended_) {
+        return;
+    }
+    RemoveFromReadyList(&pt);
+    pt_extend_disable_irq();
+    cold.suspended_ = true;
+    AddToListEnd(pt.scheduler_->waitList_, &pt);
+    pt_extend_enable_irq();
+}
+
+/* 就绪结构只属于调度器线程, 其他线程经ResumeTaskFromISR投递 */
+void ResumeTask(PtExtend& pt) {
+    auto& cold = TaskColdOf(pt);
+    pt_extend_disable_irq();
+    if (!cold.suspended_) {
+        pt_extend_enable_irq();
+        return;
+    }
+    cold.suspended_ = false;
+    RemoveFromList(pt.scheduler_->waitList_, &pt);
+    pt_extend_enable_irq();
+    AddToReadyList(&pt);
+}
+
+// --------------------------------------------------------------------------------
+// Timed Wait
+// --------------------------------------------------------------------------------
+/* 以下都在临界区内调用 */
+
+/* 被Give唤醒的超时等待者, 从延时结构上摘下 */
+static void CancelEventTimeouts(RefList woken) {
+    for (auto* pt = TaskAt(woken.head_); pt; pt = TaskAt(pt->next_)) {
+        if (pt->waitState_ == kWaitEvent) {
+            auto& cold = TaskColdOf(*pt);
+            pt->scheduler_->delayWheel_.Remove(&cold);
+            pt->waitState_ = kWaitNone;
+            cold.waitEvent_ = nullptr;
+        }
+    }
+}
+
+/* 延时到期 */
+static void ExpireTimer(TaskCold* cold) {
+    auto* pt = TaskAt(cold->id_);
+    switch (pt->waitState_) {
+    case kWaitEvent: {
+        /* 从事件上摘下, 归还等待时占用的计数 */
+        auto* e = cold->waitEvent_;
+        RemoveFromList(e->list_, pt);
+        e->count_.fetch_add(1, std::memory_order_acq_rel);
+        pt->waitState_ = kWaitNone;
+        cold->waitEvent_ = nullptr;
+        pt->waitResult_ = kWaitTimeout;
+        AddToReadyList(pt);
+        break;
+    }
+    case kWaitCondition:
+        /* 任务仍在就绪队列, 由FinishWaitCondition发现 */
+        pt->waitState_ = kWaitNone;
+        pt->waitResult_ = kWaitTimeout;
+        break;
+    default:
+        AddToReadyList(pt);
+        break;
+    }
+}
+
+void StartWaitCondition(int64_t timeoutTicks) {
+    auto* self = GetCurrentTask();
+    self->waitResult_ = kWaitSignaled;
+    if (timeoutTicks < 0) {
+        self->waitState_ = kWaitNone;
+        return;
+    }
+    pt_extend_disable_irq();
+    self->waitState_ = kWaitCondition;
+    self->scheduler_->delayWheel_.Add(&TaskColdOf(*self), timeoutTicks);
+    pt_extend_enable_irq();
+}
+
+bool FinishWaitCondition(bool cond) {
+    auto* self = GetCurrentTask();
+    bool done = cond;
+    pt_extend_disable_irq();
+    if (self->waitState_ == kWaitCondition) {
+        if (cond) {
+            self->scheduler_->delayWheel_.Remove(&TaskColdOf(*self));
+            self->waitState_ = kWaitNone;
+        }
+    } else if (cond) {
+        /* 条件和超时同时发生时算作满足 */
+        self->waitResult_ = kWaitSignaled;
+    } else {
+        done = self->waitResult_ == kWaitTimeout;
+    }
+    pt_extend_enable_irq();
+    return done;
+}
+
+// --------------------------------------------------------------------------------
+// Event
+// --------------------------------------------------------------------------------
+/*
+ * count_ > 0 是可用计数, < 0 是等待的任务数.
+ * 计数变成负数和挂到list_在同一个临界区内完成, 所以看到负数的Give进临界区后一定能找到等待者.
+ * 没有等待者时Give/Take只做一次CAS.
+ */
+void PtEvent::GiveN(uint32_t n) {
+    if (n == 0) {
+        return;
+    }
+    int32_t count = count_.load(std::memory_order_relaxed);
+    while (count >= 0) {
+        if (count_.compare_exchange_weak(count, count + static_cast<int32_t>(n), std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+    }
+
+    pt_extend_disable_irq();
+    int32_t old = count_.fetch_add(static_cast<int32_t>(n), std::memory_order_acq_rel);
+    RefList woken;
+    if (old < 0) {
+        uint32_t waiters = static_cast<uint32_t>(-old);
+        woken = PopFrontN(list_, waiters < n ? waiters : n);
+        CancelEventTimeouts(woken);
+    }
+    /* 放回的任务可能马上在别的worker上运行并改写next_, 所以在临界区内遍历 */
+    AddChainToReadyList(woken);
+    pt_extend_enable_irq();
+}
+
+bool PtEvent::TakeOrPark(int64_t timeoutTicks) {
+    pt_extend_disable_irq();
+    if (count_.fetch_sub(1, std::memory_order_acq_rel) > 0) {
+        pt_extend_enable_irq();
+        return false;
+    }
+    auto* self = GetCurrentTask();
+    RemoveFromReadyList(self);
+    AddToListEnd(list_, self);
+    if (timeoutTicks >= 0) {
+        auto& cold = TaskColdOf(*self);
+        self->waitState_ = kWaitEvent;
+        cold.waitEvent_ = this;
+        self->scheduler_->delayWheel_.Add(&cold, timeoutTicks);
+    }
+    pt_extend_enable_irq();
+    return true;
+}
+
+// --------------------------------------------------------------------------------
+// Wait Queue
+// --------------------------------------------------------------------------------
+/*
+ * 等待者先增加waiters_再读epoch_, Notify先增加epoch_再读waiters_,
+ * 所以Notify看到0个等待者时, 正在挂起的任务一定会看到epoch_变化而放弃挂起.
+ */
+bool WaitQueue::ParkIfUnchanged(uint32_t epoch) {
+    pt_extend_disable_irq();
+    waiters_.fetch_add(1);
+    if (epoch_.load() != epoch) {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        pt_extend_enable_irq();
+        return false;
+    }
+    auto* self = GetCurrentTask();
+    RemoveFromReadyList(self);
+    AddToListEnd(list_, self);
+    pt_extend_enable_irq();
+    return true;
+}
+
+void WaitQueue::Notify() {
+    epoch_.fetch_add(1);
+    if (waiters_.load() == 0) {
+        return;
+    }
+
+    pt_extend_disable_irq();
+    RefList woken = list_;
+    list_ = {};
+    waiters_.store(0, std::memory_order_relaxed);
+    AddChainToReadyList(woken);
+    pt_extend_enable_irq();
+}
+
+// --------------------------------------------------------------------------------
+// Event Inbox
+// --------------------------------------------------------------------------------
+/*
+ * 只有原子操作, 唤醒调度器见WakeScheduler
+ * 这里先加pendingGives_再看inInbox_, DrainEventInbox先清inInbox_再取pendingGives_, 是store-buffering,
+ * 四个操作都要seq_cst, 否则两边可能都看到旧值: 这里以为还在队列里, 那边已经取完, 这次Give就丢了
+*/
+void PtEvent::GiveFromISR() {
+    auto& s = scheduler_ ? *scheduler_ : *defaultScheduler;
+    pendingGives_.fetch_add(1);
+    if (!inInbox_.exchange(true)) {
+        s.eventInbox_.Push(this);
+    }
+#if PT_EXTEND_TICKLESS_IDLE
+    WakeScheduler(s);
+#endif
+}
+
+/* 在调度器线程把投递的Give补上, 一轮只需一次exchange */
+static void DrainEventInbox(Scheduler& s) {
+    if (s.eventInbox_.Empty()) {
+        return;
+    }
+    auto* e = s.eventInbox_.PopAll();
+    while (e) {
+        auto* next = e->inboxNext_;
+        e->inInbox_.store(false);
+        e->GiveN(e->pendingGives_.exchange(0));
+        e = next;
+    }
+}
+
+/* 同GiveFromISR, 在队列里时不重复投递, 处理时先清标记再恢复, 所以不会漏掉之后的投递 */
+void ResumeTaskFromISR(PtExtend& pt) {
+    auto& s = *pt.scheduler_;
+    auto& cold = TaskColdOf(pt);
+    if (!cold.inInbox_.exchange(true)) {
+        s.resumeInbox_.Push(&cold);
+    }
+#if PT_EXTEND_TICKLESS_IDLE
+    WakeScheduler(s);
+#endif
+}
+
+static void DrainResumeInbox(Scheduler& s) {
+    if (s.resumeInbox_.Empty()) {
+        return;
+    }
+    auto* cold = s.resumeInbox_.PopAll();
+    while (cold) {
+        auto* next = cold->inboxNext_;
+        cold->inInbox_.store(false);
+        ResumeTask(*TaskAt(cold->id_));
+        cold = next;
+    }
+}
+
+// --------------------------------------------------------------------------------
+// Delay
+// --------------------------------------------------------------------------------
+uint32_t tickResolutionUs = kDefaultTickUs;
+
+void SetTickResolution(uint32_t us) {
+    tickResolutionUs = std::clamp<uint32_t>(us, 1, 1'000'000);
+}
+
+void TimerTick(uint32_t tickPlus) {
+    TimerTick(CurrentScheduler(), tickPlus);
+}
+
+void TimerTick(Scheduler& scheduler, uint32_t tickPlus) {
+    scheduler.tickEscape_ += tickPlus;
+#if PT_EXTEND_TICKLESS_IDLE
+    WakeScheduler(scheduler);
+#endif
+}
+
+#if PT_EXTEND_TICKLESS_IDLE
+static void SyncClockTicks(Scheduler& s);
+#endif
+
+/* 临界区内调用, 包括已经经过但还没推进时间轮的tick */
+static uint64_t CurrentTick(Scheduler& s) {
+#if PT_EXTEND_TICKLESS_IDLE
+    SyncClockTicks(s);
+#endif
+    return s.delayWheel_.Now() + s.tickEscape_.load();
+}
+
+uint64_t GetTickCount() {
+    auto& s = CurrentScheduler();
+    pt_extend_disable_irq();
+    uint64_t now = CurrentTick(s);
+    pt_extend_enable_irq();
+    return now;
+}
+
+bool DelayUntil(uint64_t& lastWake, int64_t periodTicks) {
+    auto* self = GetCurrentTask();
+    auto& s = *self->scheduler_;
+    uint64_t period = periodTicks < 1 ? 1 : static_cast<uint64_t>(periodTicks);
+    pt_extend_disable_irq();
+    uint64_t now = CurrentTick(s);
+    pt_extend_enable_irq();
+
+    uint64_t next = lastWake + period;
+    if (next > now) {
+        lastWake = next;
+        return true;
+    }
+    /* 正好到期时按时运行; 错过时跳到不晚于现在的最后一个周期边界, 之后仍按原来的相位 */
+    lastWake = next + (now - next) / period * period;
+    if (next != now) {
+        TaskColdOf(*self).periodOverruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return false;
+}
+
+/* 延时相对于时间轮已经处理到的tick */
+int64_t TicksUntil(uint64_t tick) {
+    auto& s = *GetCurrentTask()->scheduler_;
+    pt_extend_disable_irq();
+    uint64_t wheelNow = s.delayWheel_.Now();
+    pt_extend_enable_irq();
+    return tick > wheelNow ? static_cast<int64_t>(tick - wheelNow) : 0;
+}
+
+// --------------------------------------------------------------------------------
+// Reactor
+// --------------------------------------------------------------------------------
+#if PT_EXTEND_EPOLL_REACTOR
+/*
+ * 同一时间只有一个线程在epoll_wait和分发(reactorMutex), 分发在临界区内.
+ * CloseFd之后已经取回的事件可能还指向这个PtFd, 所以先放进retireList,
+ * 由下一次分发结束时释放, 那之后开始的epoll_wait不会再返回它.
+ */
+static std::mutex reactorMutex;
+static std::atomic<uint32_t> reactorFds = 0; /* 注册的加上未释放的, 为0时不轮询 */
+static PtFd* retireList = nullptr;
+#if PT_EXTEND_TICKLESS_IDLE
+static int reactorWakeFd = -1; /* eventfd, data.ptr为nullptr */
+#if PT_EXTEND_TIMERFD
+static int reactorTimerFd = -1; /* 空闲睡眠的到期时间, data.ptr为nullptr */
+#endif
+static std::atomic<bool> reactorSleeping = false;
+#endif
+
+static int CreateReactor() {
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+#if PT_EXTEND_TICKLESS_IDLE
+    if (epollFd >= 0) {
+        reactorWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        epoll_event ev = {.events = EPOLLIN, .data = {.ptr = nullptr}};
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, reactorWakeFd, &ev);
+#if PT_EXTEND_TIMERFD
+        reactorTimerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (reactorTimerFd >= 0) {
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, reactorTimerFd, &ev);
+        }
+#endif
+    }
+#endif
+    return epollFd;
+}
+
+static int ReactorFd() {
+    static int epollFd = CreateReactor();
+    return epollFd;
+}
+
+PtFd* OpenFd(int fd) {
+    if (&CurrentScheduler() != defaultScheduler) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    if (ReactorFd() < 0) {
+        return nullptr;
+    }
+    auto* f = new PtFd{.fd_ = fd};
+    epoll_event ev = {.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data = {.ptr = f}};
+    if (epoll_ctl(ReactorFd(), EPOLL_CTL_ADD, fd, &ev) != 0) {
+        int err = errno;
+        delete f;
+        errno = err;
+        return nullptr;
+    }
+    ++reactorFds;
+    return f;
+}
+
+void CloseFd(PtFd* f) {
+    epoll_ctl(ReactorFd(), EPOLL_CTL_DEL, f->fd_, nullptr);
+    pt_extend_disable_irq();
+    f->closed_ = true;
+    f->retireNext_ = retireList;
+    retireList = f;
+    pt_extend_enable_irq();
+}
+
+bool PtFd::WaitOrPark(uint32_t interest) {
+    pt_extend_disable_irq();
+    if (ready_ & interest) {
+        ready_ &= ~interest;
+        pt_extend_enable_irq();
+        return false;
+    }
+    auto* self = GetCurrentTask();
+    RequireDefaultScheduler(self, "pt_fd_wait");
+    RemoveFromReadyList(self);
+    (interest == kFdReadable ? readWaiter_ : writeWaiter_) = self;
+    pt_extend_enable_irq();
+    return true;
+}
+
+/* 临界区内调用, 有等待者时边沿直接交给它 */
+static void WakeFd(PtFd* f, uint32_t ready) {
+    if (ready & kFdReadable) {
+        if (f->readWaiter_ != nullptr) {
+            AddToReadyList(f->readWaiter_);
+            f->readWaiter_ = nullptr;
+        } else {
+            f->ready_ |= kFdReadable;
+        }
+    }
+    if (ready & kFdWritable) {
+        if (f->writeWaiter_ != nullptr) {
+            AddToReadyList(f->writeWaiter_);
+            f->writeWaiter_ = nullptr;
+        } else {
+            f->ready_ |= kFdWritable;
+        }
+    }
+}
+
+/* 持有reactorMutex时调用, timeoutMs: 0不阻塞, -1一直等待 */
+static void ReactorPoll(int timeoutMs) {
+    static epoll_event events[kReactorMaxEvents];
+    int n = epoll_wait(ReactorFd(), events, kReactorMaxEvents, timeoutMs);
+
+    pt_extend_disable_irq();
+    for (int i = 0; i < n; i++) {
+        auto* f = static_cast<PtFd*>(events[i].data.ptr);
+        if (f == nullptr || f->closed_) {
+            continue;
+        }
+        /* 挂断和错误两个方向都唤醒, 由读写调用得到结果 */
+        uint32_t ready = 0;
+        if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) {
+            ready |= kFdReadable;
+        }
+        if (events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR)) {
+            ready |= kFdWritable;
+        }
+        WakeFd(f, ready);
+    }
+    auto* retired = std::exchange(retireList, nullptr);
+    pt_extend_enable_irq();
+
+    while (retired != nullptr) {
+        delete std::exchange(retired, retired->retireNext_);
+        --reactorFds;
+    }
+#if PT_EXTEND_TICKLESS_IDLE
+    uint64_t drain;
+    while (read(reactorWakeFd, &drain, sizeof(drain)) > 0) {
+    }
+#if PT_EXTEND_TIMERFD
+    (void)!read(reactorTimerFd, &drain, sizeof(drain));
+#endif
+#endif
+}
+
+/* 不阻塞地分发已经就绪的fd, 别的线程正在轮询时直接返回 */
+static void ReactorPollNow() {
+    if (reactorFds.load() == 0) {
+        return;
+    }
+    std::unique_lock lock{reactorMutex, std::try_to_lock};
+    if (lock.owns_lock()) {
+        ReactorPoll(0);
+    }
+}
+#endif
+
+// --------------------------------------------------------------------------------
+// Async I/O
+// --------------------------------------------------------------------------------
+#if PT_EXTEND_IO_URING
+/*
+ * SubmitIo只写SQE, 本轮调度结束后在SchedulerIdle里一次io_uring_enter整批提交,
+ * 完成队列在同一位置直接读共享内存收割, 不需要系统调用.
+ * 没有就绪任务且有未完成的操作时睡在io_uring_enter上, WakeScheduler和epoll反应器用POLL_ADD唤醒它.
+ * io_uring不可用(内核低于5.11或被seccomp禁止)时交给阻塞线程池, 完成后经MpscInbox回到调度器线程.
+ */
+struct IoRing {
+    int fd_ = -1;
+    uint32_t sqEntries_{};
+    uint32_t sqMask_{};
+    uint32_t* sqHead_{};
+    uint32_t* sqTail_{};
+    uint32_t* sqFlags_{};
+    uint32_t* sqArray_{};
+    io_uring_sqe* sqes_{};
+    uint32_t cqMask_{};
+    uint32_t* cqHead_{};
+    uint32_t* cqTail_{};
+    io_uring_cqe* cqes_{};
+    uint32_t pending_{};  /* 已写入未提交的SQE */
+    uint32_t inflight_{}; /* 已写入未完成的PtIo */
+#if PT_EXTEND_TICKLESS_IDLE
+    bool wakeArmed_{};
+#if PT_EXTEND_EPOLL_REACTOR
+    bool reactorArmed_{};
+#endif
+#endif
+};
+static IoRing ioRing;
+/* 内部POLL_ADD的user_data, 其余都是PtIo* */
+static constexpr uint64_t kIoTagWake = 0;
+static constexpr uint64_t kIoTagReactor = 1;
+#if PT_EXTEND_TICKLESS_IDLE
+static int ioWakeFd = -1;
+static std::atomic<bool> ioSleeping = false;
+#endif
+
+static int EnterIoRing(uint32_t toSubmit, uint32_t minComplete, uint32_t flags, const void* arg, size_t argSize) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ioRing.fd_, toSubmit, minComplete, flags, arg, argSize));
+}
+
+static bool SetupIoRing() {
+    io_uring_params params = {};
+    int fd = static_cast<int>(syscall(__NR_io_uring_setup, kIoRingEntries, &params));
+    if (fd < 0) {
+        return false;
+    }
+    /* 需要EXT_ARG(5.11)做带超时的等待, NODROP保证未完成数超过完成队列时不丢 */
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP)) {
+        close(fd);
+        return false;
+    }
+    size_t ringSize = std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    void* ring = mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+    void* sqes = mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        munmap(ring, ringSize);
+        close(fd);
+        return false;
+    }
+
+    auto field = [ring](uint32_t offset) { return reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(ring) + offset); };
+    ioRing.sqEntries_ = params.sq_entries;
+    ioRing.sqMask_ = *field(params.sq_off.ring_mask);
+    ioRing.sqHead_ = field(params.sq_off.head);
+    ioRing.sqTail_ = field(params.sq_off.tail);
+    ioRing.sqFlags_ = field(params.sq_off.flags);
+    ioRing.sqArray_ = field(params.sq_off.array);
+    ioRing.sqes_ = static_cast<io_uring_sqe*>(sqes);
+    ioRing.cqMask_ = *field(params.cq_off.ring_mask);
+    ioRing.cqHead_ = field(params.cq_off.head);
+    ioRing.cqTail_ = field(params.cq_off.tail);
+    ioRing.cqes_ = reinterpret_cast<io_uring_cqe*>(static_cast<uint8_t*>(ring) + params.cq_off.cqes);
+#if PT_EXTEND_TICKLESS_IDLE
+    ioWakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+    ioRing.fd_ = fd;
+    return true;
+}
+
+static bool IoRingReady() {
+    static bool ready = SetupIoRing();
+    return ready;
+}
+
+/* 提交已写入的SQE */
+static void FlushIo() {
+    if (ioRing.pending_ == 0) {
+        return;
+    }
+    int submitted = EnterIoRing(ioRing.pending_, 0, 0, nullptr, 0);
+    if (submitted > 0) {
+        ioRing.pending_ -= static_cast<uint32_t>(submitted);
+    }
+}
+
+/* 取下一个空的SQE, 满时先提交, 仍然满返回nullptr */
+static io_uring_sqe* GetSqe() {
+    uint32_t tail = *ioRing.sqTail_;
+    if (tail - std::atomic_ref{*ioRing.sqHead_}.load(std::memory_order_acquire) == ioRing.sqEntries_) {
+        FlushIo();
+        if (tail - std::atomic_ref{*ioRing.sqHead_}.load(std::memory_order_acquire) == ioRing.sqEntries_) {
+            return nullptr;
+        }
+    }
+    uint32_t index = tail & ioRing.sqMask_;
+    auto* sqe = &ioRing.sqes_[index];
+    *sqe = {};
+    ioRing.sqArray_[index] = index;
+    return sqe;
+}
+
+static void PublishSqe() {
+    std::atomic_ref{*ioRing.sqTail_}.store(*ioRing.sqTail_ + 1, std::memory_order_release);
+    ++ioRing.pending_;
+}
+
+static void ReapCompletions() {
+    uint32_t head = *ioRing.cqHead_;
+    uint32_t tail = std::atomic_ref{*ioRing.cqTail_}.load(std::memory_order_acquire);
+    for (; head != tail; head++) {
+        const auto& cqe = ioRing.cqes_[head & ioRing.cqMask_];
+        if (cqe.user_data == kIoTagWake) {
+#if PT_EXTEND_TICKLESS_IDLE
+            uint64_t drain;
+            while (read(ioWakeFd, &drain, sizeof(drain)) > 0) {
+            }
+            ioRing.wakeArmed_ = false;
+#endif
+        } else if (cqe.user_data == kIoTagReactor) {
+            /* 由之后的ReactorPollNow分发 */
+#if PT_EXTEND_TICKLESS_IDLE && PT_EXTEND_EPOLL_REACTOR
+            ioRing.reactorArmed_ = false;
+#endif
+        } else {
+            auto* io = reinterpret_cast<PtIo*>(cqe.user_data);
+            io->result_ = cqe.res;
+            --ioRing.inflight_;
+            AddToReadyList(io->waiter_);
+        }
+    }
+    std::atomic_ref{*ioRing.cqHead_}.store(head, std::memory_order_release);
+}
+
+static void ReapIo() {
+    ReapCompletions();
+    /* 完成队列满时溢出的部分由内核暂存, 要GETEVENTS才会搬回完成队列 */
+    while (std::atomic_ref{*ioRing.sqFlags_}.load(std::memory_order_relaxed) & IORING_SQ_CQ_OVERFLOW) {
+        EnterIoRing(0, 0, IORING_ENTER_GETEVENTS, nullptr, 0);
+        ReapCompletions();
+    }
+}
+
+/* 线程池 */
+struct IoPool {
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    PtIo* head_ = nullptr;
+    PtIo* tail_ = nullptr;
+};
+static MpscInbox<PtIo> ioDoneInbox;
+
+/* 非阻塞fd返回EAGAIN时在本线程poll等待后重试 */
+static int32_t RunIoBlocking(PtIo& io) {
+    for (;;) {
+        ssize_t result = 0;
+        short events = POLLIN;
+        switch (io.op_) {
+        case kIoRead:
+            result = io.offset_ < 0 ? read(io.fd_, io.buf_, io.len_) : pread(io.fd_, io.buf_, io.len_, io.offset_);
+            break;
+        case kIoWrite:
+            events = POLLOUT;
+            result = io.offset_ < 0 ? write(io.fd_, io.buf_, io.len_) : pwrite(io.fd_, io.buf_, io.len_, io.offset_);
+            break;
+        case kIoAccept:
+            result = accept4(io.fd_, static_cast<sockaddr*>(io.buf_), io.addrLen_, static_cast<int>(io.flags_));
+            break;
+        case kIoFsync:
+            result = (io.flags_ & IORING_FSYNC_DATASYNC) ? fdatasync(io.fd_) : fsync(io.fd_);
+            break;
+        }
+        if (result >= 0) {
+            return static_cast<int32_t>(result);
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return -errno;
+        }
+        if (errno != EINTR) {
+            pollfd pfd = {.fd = io.fd_, .events = events, .revents = 0};
+            poll(&pfd, 1, -1);
+        }
+    }
+}
+
+static void IoPoolWorker(IoPool* pool) {
+    for (;;) {
+        PtIo* io;
+        {
+            std::unique_lock lock{pool->mutex_};
+            pool->cond_.wait(lock, [pool] { return pool->head_ != nullptr; });
+            io = pool->head_;
+            pool->head_ = io->inboxNext_;
+            if (pool->head_ == nullptr) {
+                pool->tail_ = nullptr;
+            }
+        }
+        io->result_ = RunIoBlocking(*io);
+        ioDoneInbox.Push(io);
+#if PT_EXTEND_TICKLESS_IDLE
+        WakeScheduler(DefaultScheduler());
+#endif
+    }
+}
+
+/* 第一次使用时启动, 工作线程分离运行, 所以池永不析构(否则退出时会析构仍有等待者的条件变量) */
+static IoPool& GetIoPool() {
+    static IoPool* pool = [] {
+        auto* created = new IoPool;
+        for (uint32_t i = 0; i < kIoPoolThreads; i++) {
+            std::thread(IoPoolWorker, created).detach();
+        }
+        return created;
+    }();
+    return *pool;
+}
+
+static void SubmitToIoPool(PtIo& io) {
+    auto& pool = GetIoPool();
+    std::lock_guard lock{pool.mutex_};
+    io.inboxNext_ = nullptr;
+    if (pool.tail_ != nullptr) {
+        pool.tail_->inboxNext_ = &io;
+    } else {
+        pool.head_ = &io;
+    }
+    pool.tail_ = &io;
+    pool.cond_.notify_one();
+}
+
+void SubmitIo(PtIo& io) {
+    auto* self = GetCurrentTask();
+    RequireDefaultScheduler(self, "SubmitIo");
+    RemoveFromReadyList(self);
+    io.waiter_ = self;
+
+    io_uring_sqe* sqe = IoRingReady() ? GetSqe() : nullptr;
+    if (sqe == nullptr) {
+        SubmitToIoPool(io);
+        return;
+    }
+    sqe->fd = io.fd_;
+    sqe->user_data = reinterpret_cast<uint64_t>(&io);
+    switch (io.op_) {
+    case kIoRead:
+    case kIoWrite:
+        sqe->opcode = io.op_ == kIoRead ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->addr = reinterpret_cast<uint64_t>(io.buf_);
+        sqe->len = io.len_;
+        sqe->off = io.offset_ < 0 ? UINT64_MAX : static_cast<uint64_t>(io.offset_);
+        break;
+    case kIoAccept:
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->addr = reinterpret_cast<uint64_t>(io.buf_);
+        sqe->addr2 = reinterpret_cast<uint64_t>(io.addrLen_);
+        sqe->accept_flags = io.flags_;
+        break;
+    case kIoFsync:
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fsync_flags = io.flags_;
+        break;
+    }
+    PublishSqe();
+    ++ioRing.inflight_;
+}
+
+/* 每轮调度调用: 提交本轮的SQE, 收割完成, 接收线程池的结果 */
+static void PollIo() {
+    if (ioRing.fd_ >= 0) {
+        FlushIo();
+        ReapIo();
+    }
+    if (ioDoneInbox.Empty()) {
+        return;
+    }
+    auto* io = ioDoneInbox.PopAll();
+    while (io) {
+        auto* next = io->inboxNext_;
+        AddToReadyList(io->waiter_);
+        io = next;
+    }
+}
+#endif
+
+// --------------------------------------------------------------------------------
+// Tickless
+// --------------------------------------------------------------------------------
+#if PT_EXTEND_TICKLESS_IDLE
+uint64_t MonotonicNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static ClockSource clockSource = MonotonicNowNs;
+
+void SetClockSource(ClockSource source) {
+    clockSource = source ? source : MonotonicNowNs;
+}
+
+static constexpr uint64_t kNoDeadline = UINT64_MAX;
+
+static uint64_t TickPeriodNs() {
+    return uint64_t{tickResolutionUs} * 1000;
+}
+
+/* 距离deadline还有多少ns, 已经到期返回0 */
+static uint64_t RemainNs(uint64_t deadline) {
+    uint64_t now = clockSource();
+    return deadline > now ? deadline - now : 0;
+}
+
+void WakeScheduler() {
+    WakeScheduler(CurrentScheduler());
+}
+
+/*
+ * 睡眠者先增加idleSleepers_再读idleSeq_和idleWakeup_, 唤醒者先写idleWakeup_再读idleSleepers_,
+ * 所以唤醒者看到0个睡眠者时, 正要睡眠的线程一定会看到idleWakeup_而不睡.
+ * Linux上唤醒只有原子操作和futex/write系统调用, 可以在信号处理函数里调用.
+ */
+#if defined(__linux__)
+static void IdleNotify(Scheduler& s) {
+    s.idleSeq_.fetch_add(1);
+    syscall(SYS_futex, &s.idleSeq_, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+}
+
+/* 序号仍是seq时睡眠, 直到被IdleNotify唤醒或者到deadline, 可能提前返回 */
+static void IdleWait(Scheduler& s, uint32_t seq, uint64_t deadline) {
+    timespec ts = {};
+    if (deadline != kNoDeadline) {
+        uint64_t remain = RemainNs(deadline);
+        if (remain == 0) {
+            return;
+        }
+        ts.tv_sec = static_cast<time_t>(remain / 1'000'000'000);
+        ts.tv_nsec = static_cast<long>(remain % 1'000'000'000);
+    }
+    syscall(SYS_futex, &s.idleSeq_, FUTEX_WAIT_PRIVATE, seq, deadline == kNoDeadline ? nullptr : &ts, nullptr, 0);
+}
+#else
+static void IdleNotify(Scheduler& s) {
+    std::lock_guard lock{s.idleMutex_};
+    s.idleCond_.notify_all();
+}
+#endif
+
+void WakeScheduler(Scheduler& scheduler) {
+    scheduler.idleWakeup_.store(true);
+    if (scheduler.idleSleepers_.load() != 0) {
+#if PT_EXTEND_EPOLL_REACTOR || PT_EXTEND_IO_URING
+        /* 只有默认调度器会睡在反应器/io_uring上 */
+        bool isDefault = &scheduler == defaultScheduler;
+#endif
+#if PT_EXTEND_EPOLL_REACTOR
+        if (isDefault && reactorSleeping.load()) {
+            uint64_t one = 1;
+            (void)!write(reactorWakeFd, &one, sizeof(one));
+        }
+#endif
+#if PT_EXTEND_IO_URING
+        if (isDefault && ioSleeping.load()) {
+            uint64_t one = 1;
+            (void)!write(ioWakeFd, &one, sizeof(one));
+        }
+#endif
+        IdleNotify(scheduler);
+    }
+}
+
+/* 把时钟经过的整tick数计入tickEscape_, 余数留到下次, 不会漂移 */
+static void SyncClockTicks(Scheduler& s) {
+    uint64_t now = clockSource();
+    if (now <= s.lastClockNs_) {
+        return;
+    }
+    uint64_t period = TickPeriodNs();
+    uint64_t ticks = (now - s.lastClockNs_) / period;
+    if (ticks > 0) {
+        s.tickEscape_ += ticks;
+        s.lastClockNs_ += ticks * period;
+    }
+}
+
+/* 下一个延时到期的时钟时间(ns), 没有延时任务返回kNoDeadline */
+static uint64_t NextDeadline(const Scheduler& s) {
+    uint64_t ticks = s.delayWheel_.NextExpiry();
+    uint64_t period = TickPeriodNs();
+    if (ticks == DelayWheel::kNoExpiry || ticks > (kNoDeadline - s.lastClockNs_) / period) {
+        return kNoDeadline;
+    }
+    return s.lastClockNs_ + ticks * period;
+}
+
+#if PT_EXTEND_EPOLL_REACTOR && !PT_EXTEND_TIMERFD
+/* epoll_wait的超时, 向上取整到毫秒以免提前醒来空转 */
+static int TimeoutMs(uint64_t deadline) {
+    if (deadline == kNoDeadline) {
+        return -1;
+    }
+    uint64_t remain = (RemainNs(deadline) + 999'999) / 1'000'000;
+    return remain < INT32_MAX ? static_cast<int>(remain) : INT32_MAX;
+}
+#endif
+
+#if PT_EXTEND_TIMERFD
+/* 把reactorTimerFd设置为deadline到期, kNoDeadline时停止 */
+static void ArmReactorTimer(uint64_t deadline) {
+    itimerspec spec = {};
+    if (deadline != kNoDeadline) {
+        /* it_value为0表示停止, 已经到期的设为1ns */
+        uint64_t remain = std::max<uint64_t>(RemainNs(deadline), 1);
+        spec.it_value.tv_sec = static_cast<time_t>(remain / 1'000'000'000);
+        spec.it_value.tv_nsec = static_cast<long>(remain % 1'000'000'000);
+    }
+    timerfd_settime(reactorTimerFd, 0, &spec, nullptr);
+}
+#endif
+
+#if PT_EXTEND_IO_URING
+static bool ArmIoPoll(int fd, uint64_t tag) {
+    auto* sqe = GetSqe();
+    if (sqe == nullptr) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = tag;
+    PublishSqe();
+    return true;
+}
+
+/* 提交并等待至少一个完成, 或deadline, 或被WakeScheduler/注册的fd就绪唤醒 */
+static void WaitIo(uint64_t deadline) {
+    if (!ioRing.wakeArmed_) {
+        ioRing.wakeArmed_ = ArmIoPoll(ioWakeFd, kIoTagWake);
+    }
+#if PT_EXTEND_EPOLL_REACTOR
+    if (!ioRing.reactorArmed_ && reactorFds.load() != 0) {
+        ioRing.reactorArmed_ = ArmIoPoll(ReactorFd(), kIoTagReactor);
+    }
+#endif
+
+    __kernel_timespec ts = {};
+    io_uring_getevents_arg arg = {.sigmask = 0, .sigmask_sz = _NSIG / 8, .pad = 0, .ts = 0};
+    if (deadline != kNoDeadline) {
+        uint64_t remain = RemainNs(deadline);
+        ts.tv_sec = static_cast<int64_t>(remain / 1'000'000'000);
+        ts.tv_nsec = static_cast<long long>(remain % 1'000'000'000);
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+    }
+    int submitted = EnterIoRing(ioRing.pending_, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    if (submitted > 0) {
+        ioRing.pending_ -= static_cast<uint32_t>(submitted);
+    }
+    ReapIo();
+}
+#endif
+
+/* 睡眠直到deadline或者被WakeScheduler唤醒 */
+static void IdleSleep(Scheduler& s, uint64_t deadline) {
+    auto woken = [&s] {
+        return s.idleWakeup_.load() || s.stop_.load();
+    };
+
+    ++s.idleSleepers_;
+#if defined(__linux__)
+    uint32_t seq = s.idleSeq_.load();
+#endif
+#if PT_EXTEND_EPOLL_REACTOR || PT_EXTEND_IO_URING
+    bool isDefault = &s == defaultScheduler;
+#endif
+#if PT_EXTEND_EPOLL_REACTOR
+    std::unique_lock reactorLock{reactorMutex, std::defer_lock};
+#endif
+#if PT_EXTEND_IO_URING
+    /* 有未完成的io_uring操作时睡在io_uring_enter上, 同时等待WakeScheduler和注册的fd */
+    if (isDefault && ioRing.inflight_ != 0) {
+        ioSleeping.store(true);
+        if (!woken()) {
+            WaitIo(deadline);
+        }
+        ioSleeping.store(false);
+    } else
+#endif
+#if PT_EXTEND_TIMERFD
+    /* 由一个线程睡在epoll上, 到期由timerfd唤醒, WakeScheduler通过eventfd唤醒, 其余线程由IdleWait睡眠 */
+    if (isDefault && ReactorFd() >= 0 && reactorTimerFd >= 0 && reactorLock.try_lock()) {
+        reactorSleeping.store(true);
+        if (woken()) {
+            ReactorPoll(0);
+        } else {
+            ArmReactorTimer(deadline);
+            ReactorPoll(-1);
+        }
+        reactorSleeping.store(false);
+    } else
+#elif PT_EXTEND_EPOLL_REACTOR
+    /* 有注册的fd时由一个线程睡在epoll上, WakeScheduler通过eventfd唤醒它, 其余线程由IdleWait睡眠 */
+    if (isDefault && reactorFds.load() != 0 && reactorLock.try_lock()) {
+        reactorSleeping.store(true);
+        ReactorPoll(woken() ? 0 : TimeoutMs(deadline));
+        reactorSleeping.store(false);
+    } else
+#endif
+    if (!woken()) {
+#if defined(__linux__)
+        IdleWait(s, seq, deadline);
+#else
+        std::unique_lock lock{s.idleMutex_};
+        if (deadline == kNoDeadline) {
+            s.idleCond_.wait(lock, woken);
+        } else {
+            /* 时钟源不一定是steady_clock, 换算成相对时间等待 */
+            s.idleCond_.wait_for(lock, std::chrono::nanoseconds{RemainNs(deadline)}, woken);
+        }
+#endif
+    }
+    --s.idleSleepers_;
+    s.idleWakeup_.store(false);
+}
+#endif
+
+// --------------------------------------------------------------------------------
+// Idle
+// --------------------------------------------------------------------------------
+/* 每个调度器的idle_任务, 推进它的时间轮 */
+void IdleTask(void*) {
+    auto& s = *GetCurrentTask()->scheduler_;
+    if (s.tickEscape_ == 0) {
+        return;
+    }
+
+    s.delayWheel_.Advance(s.tickEscape_.exchange(0), ExpireTimer);
+}
+
+// --------------------------------------------------------------------------------
+// Scheduler
+// --------------------------------------------------------------------------------
+/* 当前任务和嵌套层数是线程的执行上下文, 一个线程同一时间只运行一个调度器 */
+constinit thread_local PtExtend* pCurrentTask = nullptr;
+constinit thread_local pt* pCurrentCallPt = nullptr;
+#if PT_EXTEND_NEST_SUPPORT
+constinit thread_local uint32_t nestingLevel = 0;
+#endif
+
+void StaticEndCurrent() {
+#if PT_EXTEND_NEST_SUPPORT
+    ReleaseCallStack(*pCurrentTask);
+#endif
+#if PT_EXTEND_TASK_STATS
+    UnregisterStats(pCurrentTask);
+#endif
+    UnregisterStaticTask(*pCurrentTask);
+}
+
+#if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
+void DynamicDeleteCurrent() {
+    #if PT_EXTEND_NEST_SUPPORT
+    ReleaseCallStack(*pCurrentTask);
+    #endif
+    if (auto* group = TaskColdOf(*pCurrentTask).group_) {
+        group->Leave();
+    }
+#if PT_EXTEND_TASK_STATS
+    UnregisterStats(pCurrentTask);
+#endif
+    DeleteTask(pCurrentTask);
+    pCurrentTask = nullptr;
+}
+#endif
+
+#if !PT_EXTEND_WORK_STEALING
+static void ResumeCurrent() {
+#if PT_EXTEND_TASK_STATS
+    uint64_t resumeBegin = StatsNow();
+#endif
+    pCurrentTask->taskCode_(TaskUserData(*pCurrentTask));
+#if PT_EXTEND_TASK_STATS
+    /* 动态任务已经删除, 或者静态任务已经结束归还了下标 */
+    if (pCurrentTask != nullptr && pCurrentTask->id_ != kNoTask) {
+        RecordResume(StatsOf(pCurrentTask), StatsNow() - resumeBegin);
+    }
+#endif
+}
+
+/* 时间/投递处理, 返回false表示没有就绪任务 */
+static bool SchedulerIdle(Scheduler& s) {
+#if PT_EXTEND_TICKLESS_IDLE
+    SyncClockTicks(s);
+#endif
+    /* 时间轮为空时也要推进, GetTickCount和pt_extend_delay_until依赖它不丢tick */
+    if (s.tickEscape_ > 0 || ReadyEmpty(s)) {
+        SetCurrentTask(s.idle_);
+        s.idle_.taskCode_(nullptr);
+    }
+
+    /* 其他线程/中断投递的Give/Resume */
+    DrainEventInbox(s);
+    DrainResumeInbox(s);
+#if PT_EXTEND_IO_URING || PT_EXTEND_EPOLL_REACTOR
+    if (&s == &DefaultScheduler()) {
+#if PT_EXTEND_IO_URING
+        PollIo();
+#endif
+#if PT_EXTEND_EPOLL_REACTOR
+        ReactorPollNow();
+#endif
+    }
+#endif
+
+    if (ReadyEmpty(s)) {
+#if PT_EXTEND_TICKLESS_IDLE
+        IdleSleep(s, NextDeadline(s));
+#endif
+        return false;
+    }
+    return true;
+}
+
+#if PT_EXTEND_ENABLE_PRIORITY || PT_EXTEND_ENABLE_EDF
+/*
+ * RunScheduler/RunSchedulerEdf每次只恢复一个任务, 每次都走SchedulerIdle要多一次读时钟和IO轮询;
+ * 就绪结构不空时只检查tick和投递队列, 连续kIdleCheckInterval次恢复后再完整处理一次,
+ * tickless模式下延时/超时的唤醒最多晚这么多次恢复
+*/
+static constexpr uint32_t kIdleCheckInterval = 16;
+
+static bool SchedulerIdleBatched(Scheduler& s, uint32_t& resumes) {
+    if (++resumes < kIdleCheckInterval && !ReadyEmpty(s) && s.tickEscape_.load(std::memory_order_relaxed) == 0 &&
+        s.eventInbox_.Empty() && s.resumeInbox_.Empty()) {
+        return true;
+    }
+    resumes = 0;
+    return SchedulerIdle(s);
+}
+#endif
+
+/* 开始运行当前调度器 */
+static Scheduler& StartScheduler() {
+    auto& s = CurrentScheduler();
+#if PT_EXTEND_TICKLESS_IDLE
+    s.lastClockNs_ = clockSource();
+#endif
+    return s;
+}
+
+/* StopScheduler之后返回true, 并清除停止请求 */
+static bool SchedulerStopped(Scheduler& s) {
+    if (!s.stop_.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    s.stop_.store(false);
+    return true;
+}
+
+void StopScheduler(Scheduler& scheduler) {
+    scheduler.stop_.store(true);
+#if PT_EXTEND_TICKLESS_IDLE
+    WakeScheduler(scheduler);
+#endif
+}
+
+#if !PT_EXTEND_ENABLE_EDF
+/* 只运行本轮开始时的队尾及之前的任务, 本轮唤醒追加到队尾的留到下一轮, 否则互相唤醒的任务让这一轮不结束 */
+static void RunPass(RefList& list) {
+    TaskId last = list.tail_;
+    auto* pt = TaskAt(list.head_);
+    while (pt) {
+        auto* next = TaskAt(pt->next_);
+        bool isLast = pt->id_ == last;
+        SetCurrentTask(*pt);
+        ResumeCurrent();
+        if (isLast) {
+            break;
+        }
+        pt = next;
+    }
+    pCurrentTask = nullptr;
+}
+#endif
+
+void RunSchedulerNoPriority() {
+#if PT_EXTEND_ENABLE_EDF
+    /* 就绪任务不全在链表里, 没有按轮运行的顺序 */
+    RunSchedulerEdf();
+#else
+    auto& s = StartScheduler();
+    while (!SchedulerStopped(s)) {
+        if (!SchedulerIdle(s)) {
+            continue;
+        }
+
+#if PT_EXTEND_ENABLE_PRIORITY
+        /* 一轮内从高到低各优先级都运行一次 */
+        for (uint32_t bits = s.readyBitmap_; bits != 0;) {
+            uint32_t priority = 31 - std::countl_zero(bits);
+            bits &= ~(1u << priority);
+            RunPass(s.readyLists_[priority]);
+        }
+#else
+        RunPass(s.readyList_);
+#endif
+    }
+#endif
+}
+
+#if PT_EXTEND_STATIC_TASK_SET
+void RunSchedulerStatic(void (*staticPass)()) {
+    auto& s = StartScheduler();
+    while (!SchedulerStopped(s)) {
+        if (!SchedulerIdle(s)) {
+            continue;
+        }
+
+        staticPass();
+        RunPass(s.readyList_);
+    }
+}
+#endif
+
+#if PT_EXTEND_ENABLE_PRIORITY
+void RunScheduler() {
+    auto& s = StartScheduler();
+    uint32_t resumes = 0;
+    while (!SchedulerStopped(s)) {
+        if (!SchedulerIdleBatched(s, resumes)) {
+            continue;
+        }
+
+        uint32_t priority = HighestReadyPriority(s);
+        auto& list = s.readyLists_[priority];
+        TaskId id = list.head_;
+        auto* pt = TaskAt(id);
+        SetCurrentTask(*pt);
+        ResumeCurrent();
+
+        /* 仍在队首说明仍然就绪, 轮转到同优先级队尾 */
+        if (list.head_ == id && pt->next_ != kNoTask) {
+            PopFront(list);
+            AddToListEnd(list, pt);
+        }
+    }
+}
+#endif
+
+#if PT_EXTEND_ENABLE_EDF
+void RunSchedulerEdf() {
+    auto& s = StartScheduler();
+    uint32_t resumes = 0;
+    while (!SchedulerStopped(s)) {
+        if (!SchedulerIdleBatched(s, resumes)) {
+            continue;
+        }
+
+        if (!s.readyHeap_.Empty()) {
+            SetCurrentTask(*s.readyHeap_.Top());
+            ResumeCurrent();
+            continue;
+        }
+
+        /* 没有截止时间的任务同RunScheduler一样轮转 */
+        auto& list = s.readyList_;
+        TaskId id = list.head_;
+        auto* pt = TaskAt(id);
+        SetCurrentTask(*pt);
+        ResumeCurrent();
+        if (list.head_ == id && pt->next_ != kNoTask) {
+            PopFront(list);
+            AddToListEnd(list, pt);
+        }
+    }
+}
+#endif
+#endif
+
+// --------------------------------------------------------------------------------
+// Work Stealing
+// --------------------------------------------------------------------------------
+#if PT_EXTEND_WORK_STEALING
+/*
+ * 每个worker一个Chase-Lev双端队列, 本轮运行过且仍就绪的任务放进nextPass,
+ * 队列取空后再整批放回, 保持和单线程调度一样的按轮运行.
+ * 任务在runState_上用CAS切换状态, 运行中被唤醒只标记RunningWoken,
+ * 由运行它的worker返回后重新入队, 所以同一任务不会同时在两个worker上运行.
+ * 延时/挂起/事件等共享结构由schedulerMutex保护.
+ */
+struct Worker {
+    WorkStealingDeque<PtExtend> deque{kWorkStealingDequeSize};
+    std::vector<PtExtend*> nextPass;
+};
+
+static std::mutex schedulerMutex;
+static std::vector<std::unique_ptr<Worker>> workers;
+static thread_local Worker* currentWorker = nullptr;
+static thread_local bool currentStaysReady = false;
+static std::mutex injectMutex;
+static RefList injectList;
+static std::atomic<uint32_t> injectCount = 0;
+
+void LockScheduler() {
+    schedulerMutex.lock();
+}
+
+void UnlockScheduler() {
+    schedulerMutex.unlock();
+}
+
+static void PushInject(PtExtend* pt) {
+    {
+        std::lock_guard lock{injectMutex};
+        AddToListEnd(injectList, pt);
+        ++injectCount;
+    }
+#if PT_EXTEND_TICKLESS_IDLE
+    WakeScheduler(DefaultScheduler());
+#endif
+}
+
+static void PushReady(PtExtend* pt) {
+    if (currentWorker == nullptr || !currentWorker->deque.Push(pt)) {
+        PushInject(pt);
+        return;
+    }
+#if PT_EXTEND_TICKLESS_IDLE
+    if (DefaultScheduler().idleSleepers_.load() != 0) {
+        WakeScheduler(DefaultScheduler());
+    }
+#endif
+}
+
+void AddToReadyList(PtExtend* pt) {
+    uint8_t state = pt->runState_.load();
+    for (;;) {
+        if (state == kRunStateParked) {
+            if (pt->runState_.compare_exchange_weak(state, kRunStateReady)) {
+                PushReady(pt);
+                return;
+            }
+        } else if (state == kRunStateRunning) {
+            if (pt->runState_.compare_exchange_weak(state, kRunStateRunningWoken)) {
+                return;
+            }
+        } else {
+            return;
+        }
+    }
+}
+
+/* 只有当前任务会离开就绪队列, 由worker在它返回后处理 */
+void RemoveFromReadyList(PtExtend* pt) {
+    if (pt == pCurrentTask) {
+        currentStaysReady = false;
+    }
+}
+
+/* 从注入队列取出一批(均分给各worker), 第一个直接运行, 其余放进自己的队列 */
+static PtExtend* PopInject(Worker& self) {
+    if (injectCount.load() == 0) {
+        return nullptr;
+    }
+    std::lock_guard lock{injectMutex};
+    uint32_t batch = injectCount.load() / static_cast<uint32_t>(workers.size()) + 1;
+    auto* first = PopFront(injectList);
+    if (first == nullptr) {
+        return nullptr;
+    }
+    --injectCount;
+    while (--batch != 0) {
+        auto* pt = TaskAt(injectList.head_);
+        if (pt == nullptr || !self.deque.Push(pt)) {
+            break;
+        }
+        PopFront(injectList);
+        --injectCount;
+    }
+    return first;
+}
+
+static PtExtend* StealTask(uint32_t self, uint32_t& seed) {
+    if (auto* pt = PopInject(*workers[self])) {
+        return pt;
+    }
+    uint32_t count = static_cast<uint32_t>(workers.size());
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t victim = (seed + i) % count;
+        if (victim == self) {
+            continue;
+        }
+        if (auto* pt = workers[victim]->deque.Steal()) {
+            return pt;
+        }
+    }
+    return nullptr;
+}
+
+static void FlushNextPass(Worker& self) {
+    if (self.nextPass.empty()) {
+        return;
+    }
+    for (auto* pt : self.nextPass) {
+        if (!self.deque.Push(pt)) {
+            PushInject(pt);
+        }
+    }
+    self.nextPass.clear();
+#if PT_EXTEND_TICKLESS_IDLE
+    if (DefaultScheduler().idleSleepers_.load() != 0) {
+        WakeScheduler(DefaultScheduler());
+    }
+#endif
+}
+
+/* 同一时间只有一个worker推进时间轮 */
+static void WorkStealingTick(Scheduler& s) {
+    std::unique_lock lock{schedulerMutex, std::try_to_lock};
+    if (!lock.owns_lock()) {
+        return;
+    }
+#if PT_EXTEND_TICKLESS_IDLE
+    SyncClockTicks(s);
+#endif
+    s.delayWheel_.Advance(s.tickEscape_.exchange(0), ExpireTimer);
+}
+
+static void WorkStealingIdle(Scheduler& s) {
+#if PT_EXTEND_TICKLESS_IDLE
+    uint64_t deadline;
+    {
+        std::lock_guard lock{schedulerMutex};
+        deadline = NextDeadline(s);
+    }
+    IdleSleep(s, deadline);
+#else
+    (void)s;
+    std::this_thread::yield();
+#endif
+}
+
+static void RunTask(Worker& self, PtExtend* pt) {
+    pt->runState_.store(kRunStateRunning);
+    SetCurrentTask(*pt);
+    currentStaysReady = true;
+#if PT_EXTEND_TASK_STATS
+    uint64_t resumeBegin = StatsNow();
+#endif
+    pt->taskCode_(TaskUserData(*pt));
+    if (pCurrentTask == nullptr) {
+        /* 动态任务已经删除 */
+        return;
+    }
+#if PT_EXTEND_TASK_STATS
+    /* 必须在放回队列之前, 之后别的worker可能开始运行它; 结束的静态任务已经没有统计 */
+    if (pt->id_ != kNoTask) {
+        RecordResume(StatsOf(pt), StatsNow() - resumeBegin);
+    }
+#endif
+    uint8_t running = kRunStateRunning;
+    if (currentStaysReady || !pt->runState_.compare_exchange_strong(running, kRunStateParked)) {
+        pt->runState_.store(kRunStateReady);
+        self.nextPass.push_back(pt);
+    }
+    pCurrentTask = nullptr;
+}
+
+/* 所有worker共同运行默认调度器 */
+static void WorkerLoop(uint32_t index) {
+    Worker& self = *workers[index];
+    auto& s = DefaultScheduler();
+    currentWorker = &self;
+    uint32_t seed = index * 2654435761u + 1;
+    while (!s.stop_.load(std::memory_order_relaxed)) {
+        auto* pt = self.deque.Take();
+        if (pt == nullptr) {
+            FlushNextPass(self);
+            DrainEventInbox(s);
+            DrainResumeInbox(s);
+#if PT_EXTEND_EPOLL_REACTOR
+            ReactorPollNow();
+#endif
+            WorkStealingTick(s);
+            pt = self.deque.Take();
+        }
+        if (pt == nullptr) {
+            pt = StealTask(index, seed);
+        }
+        if (pt == nullptr) {
+            WorkStealingIdle(s);
+            continue;
+        }
+        RunTask(self, pt);
+    }
+    currentWorker = nullptr;
+}
+
+void RunSchedulerWorkStealing(uint32_t workerCount) {
+    if (workerCount == 0) {
+        workerCount = 1;
+    }
+    auto& s = DefaultScheduler();
+    s.stop_ = false;
+#if PT_EXTEND_TICKLESS_IDLE
+    s.lastClockNs_ = clockSource();
+#endif
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    std::vector<std::thread> threads;
+    for (uint32_t i = 1; i < workerCount; i++) {
+        threads.emplace_back(WorkerLoop, i);
+    }
+    WorkerLoop(0);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    /* 没运行完的就绪任务留给下一次RunSchedulerWorkStealing */
+    for (auto& w : workers) {
+        while (auto* pt = w->deque.Steal()) {
+            PushInject(pt);
+        }
+        for (auto* pt : w->nextPass) {
+            PushInject(pt);
+        }
+    }
+    workers.clear();
+}
+
+void StopSchedulerWorkStealing() {
+    auto& s = DefaultScheduler();
+    s.stop_ = true;
+#if PT_EXTEND_TICKLESS_IDLE
+    WakeScheduler(s);
+#endif
+}
+#endif
+
+#if PT_EXTEND_TASK_STATS
+void PrintTaskStats() {
+    std::cout << "########################################\n";
+
+    for (const auto& stats : SnapshotTaskStats()) {
+        uint64_t avgNs = stats.resumes_ != 0 ? stats.cpuNs_ / stats.resumes_ : 0;
+        std::cout << std::format("# name: {}, cpu: {}us, resumes: {}, avg: {}ns, max: {}ns\n",
+            stats.name_, stats.cpuNs_ / 1000, stats.resumes_, avgNs, stats.maxNs_);
+    }
+
+    std::cout << "########################################\n";
+}
+#endif
+
 }
\ No newline at end of file
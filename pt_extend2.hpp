@@ -4,50 +4,298 @@
 */
 
 #pragma once
+#include <atomic>
+#include <concepts>
+#include <cstddef>
 #include <cstdint>
 #include <string_view>
+#if PT_EXTEND_IO_URING
+#include <sys/socket.h>
+#endif
+#if PT_EXTEND_TASK_STATS
+#include <vector>
+#endif
 #include "pt.h"
 
 /* 启动动态分配 */
 #define PT_EXTEND_ENABLE_DYNAMIC_ALLOC 1
-/* 任务Tick计时 */
-#define PT_EXTEND_COUNT_TASK_TICKS 0
+/* 动态任务从任务表分配时每个线程缓存一批空闲下标, 批量和全局空闲链表交换 */
+#ifndef PT_EXTEND_TCB_POOL
+#define PT_EXTEND_TCB_POOL 1
+#endif
+/* 动态任务的嵌套调用栈从按2的幂分级的池分配 */
+#ifndef PT_EXTEND_STACK_POOL
+#define PT_EXTEND_STACK_POOL 1
+#endif
+/* C++20协程任务(pt_coroutine.hpp)的协程帧从按大小分级的池分配 */
+#ifndef PT_EXTEND_COROUTINE_FRAME_POOL
+#define PT_EXTEND_COROUTINE_FRAME_POOL 1
+#endif
+/* 任务运行统计: 纳秒级CPU时间/运行次数/单次运行耗时直方图, 其他线程可以读取快照 */
+#ifndef PT_EXTEND_TASK_STATS
+#define PT_EXTEND_TASK_STATS 0
+#endif
 /* 启用协程嵌套 */
 #define PT_EXTEND_NEST_SUPPORT 1
+/* 嵌套调用栈不够时从栈池分配两倍大的栈并整体搬过去, 为0时容量固定 */
+#ifndef PT_EXTEND_CALL_STACK_GROW
+#define PT_EXTEND_CALL_STACK_GROW 1
+#endif
+/* 嵌套调用栈溢出(容量固定或分配失败)时输出任务名并陷入调试器, 默认只在调试构建打开; 关闭时调用处每轮重试 */
+#ifndef PT_EXTEND_CALL_STACK_TRAP
+#ifdef NDEBUG
+#define PT_EXTEND_CALL_STACK_TRAP 0
+#else
+#define PT_EXTEND_CALL_STACK_TRAP 1
+#endif
+#endif
+/* 无tick空闲: 调度器自己读取时钟, 没有就绪任务时睡眠到下一个延时到期 */
+#ifndef PT_EXTEND_TICKLESS_IDLE
+#define PT_EXTEND_TICKLESS_IDLE 1
+#endif
+/* epoll反应器(仅Linux): 任务挂起等待fd可读/可写, 调度器空闲时睡在epoll上直到fd就绪或下一个延时到期 */
+#ifndef PT_EXTEND_EPOLL_REACTOR
+#define PT_EXTEND_EPOLL_REACTOR 0
+#endif
+/* 默认调度器空闲时总是睡在epoll上, 由timerfd按纳秒精度唤醒, 不受epoll_wait毫秒超时限制 */
+#ifndef PT_EXTEND_TIMERFD
+#define PT_EXTEND_TIMERFD 0
+#endif
+/* io_uring异步I/O(仅Linux): 任务提交读/写/accept/fsync后挂起, 完成时恢复; io_uring不可用时使用线程池 */
+#ifndef PT_EXTEND_IO_URING
+#define PT_EXTEND_IO_URING 0
+#endif
+/* 优先级调度, 使用RunScheduler */
+#ifndef PT_EXTEND_ENABLE_PRIORITY
+#define PT_EXTEND_ENABLE_PRIORITY 0
+#endif
+/* 最早截止时间优先(EDF)调度, 使用RunSchedulerEdf, 用SetTaskDeadline声明相对截止时间 */
+#ifndef PT_EXTEND_ENABLE_EDF
+#define PT_EXTEND_ENABLE_EDF 0
+#endif
+/* 多线程工作窃取调度, 使用RunSchedulerWorkStealing */
+#ifndef PT_EXTEND_WORK_STEALING
+#define PT_EXTEND_WORK_STEALING 0
+#endif
+/* 编译期静态任务集(pt_static_tasks.hpp): 连续静态存储, 每轮直接调用, 使用RunSchedulerStatic */
+#ifndef PT_EXTEND_STATIC_TASK_SET
+#define PT_EXTEND_STATIC_TASK_SET 0
+#endif
+
+#if PT_EXTEND_STATIC_TASK_SET && (PT_EXTEND_ENABLE_PRIORITY || PT_EXTEND_ENABLE_EDF || PT_EXTEND_WORK_STEALING)
+#error "PT_EXTEND_STATIC_TASK_SET only works with RunSchedulerStatic"
+#endif
+
+#if PT_EXTEND_ENABLE_EDF && PT_EXTEND_ENABLE_PRIORITY
+#error "PT_EXTEND_ENABLE_EDF and PT_EXTEND_ENABLE_PRIORITY are mutually exclusive"
+#endif
 
+#if PT_EXTEND_TIMERFD && !(PT_EXTEND_EPOLL_REACTOR && PT_EXTEND_TICKLESS_IDLE)
+#error "PT_EXTEND_TIMERFD requires PT_EXTEND_EPOLL_REACTOR and PT_EXTEND_TICKLESS_IDLE"
+#endif
+
+#if PT_EXTEND_NEST_SUPPORT && PT_EXTEND_CALL_STACK_GROW && !PT_EXTEND_ENABLE_DYNAMIC_ALLOC
+#error "PT_EXTEND_CALL_STACK_GROW requires PT_EXTEND_ENABLE_DYNAMIC_ALLOC"
+#endif
+
+#if PT_EXTEND_WORK_STEALING
+#if PT_EXTEND_ENABLE_PRIORITY
+#error "PT_EXTEND_ENABLE_PRIORITY is not supported with PT_EXTEND_WORK_STEALING"
+#endif
+#if PT_EXTEND_ENABLE_EDF
+#error "PT_EXTEND_ENABLE_EDF is not supported with PT_EXTEND_WORK_STEALING"
+#endif
+#if PT_EXTEND_IO_URING
+#error "PT_EXTEND_IO_URING is not supported with PT_EXTEND_WORK_STEALING"
+#endif
+/* 多线程下临界区使用调度器锁 */
+#define pt_extend_disable_irq() pt_extend::LockScheduler()
+#define pt_extend_enable_irq() pt_extend::UnlockScheduler()
+#else
 #define pt_extend_disable_irq()
 #define pt_extend_enable_irq()
+#endif
 
 // --------------------------------------------------------------------------------
 // 协程上下文
 // --------------------------------------------------------------------------------
 namespace pt_extend {
 
-struct PtExtend {
-    PtExtend* next_{};
-    PtExtend* prev_{};
+/* 超时等待的状态 */
+enum WaitState : uint8_t {
+    kWaitNone,      /* 普通延时或没有在计时 */
+    kWaitEvent,     /* 同时挂在waitEvent_->list_和延时结构上 */
+    kWaitCondition, /* 仍在就绪队列轮询条件, 延时结构只负责计时 */
+};
+/* 超时等待的结果 */
+enum WaitResult : uint8_t {
+    kWaitSignaled,
+    kWaitTimeout,
+};
 
-    pt pt_ = pt_init();
-    int32_t delay_{};
+struct PtEvent;
+struct Scheduler;
+struct TaskGroup;
+
+#if PT_EXTEND_TASK_STATS
+/* 第0桶是0ns, 第i桶是[2^(i-1), 2^i)ns, 最后一桶包含所有更长的 */
+static constexpr uint32_t kTaskStatsBuckets = 32;
+
+struct PtExtend;
+
+/* 只由正在运行该任务的线程写, 读者用seq_检查读到的是否一致 */
+struct TaskStats {
+    std::atomic<uint32_t> seq_{}; /* 奇数表示正在写 */
+    std::atomic<uint64_t> cpuNs_{};
+    std::atomic<uint64_t> resumes_{};
+    std::atomic<uint64_t> maxNs_{};
+    std::atomic<uint32_t> histogram_[kTaskStatsBuckets]{};
 
-#if PT_EXTEND_COUNT_TASK_TICKS
-    uint32_t taskTicks_{}; /* task ticks in 1 second */
-    uint32_t taskTicksReal_{};
+    /* 所有任务的统计链表, 快照时遍历 */
+    PtExtend* registryNext_{};
+    PtExtend* registryPrev_{};
+};
 #endif
+
+/* 任务在任务表里的下标, 链表用它链接 */
+using TaskId = uint32_t;
+static constexpr TaskId kNoTask = UINT32_MAX;
+/* 静态任务(用户提供的TCB)的下标带这一位, 在单独的表里 */
+static constexpr TaskId kStaticTaskBit = 1u << 31;
+
+/*
+ * 热数据: 调度器遍历就绪队列/等待链表和恢复任务时访问的字段, 默认配置48字节.
+ * userData在任务表里单独的数组, 用TaskUserData访问;
+ * 名字/延时/等待/嵌套调用栈/统计等放在任务表的冷数据TaskCold里, 用TaskColdOf访问.
+ * 动态任务的PtExtend在任务表的连续数组里, 静态任务在用户提供的存储里, 添加时登记到任务表, 结束时注销.
+ */
+struct PtExtend {
+    TaskId next_ = kNoTask;
+    TaskId prev_ = kNoTask;
+    pt pt_ = pt_init();
+    void(*taskCode_)(void*);
+    Scheduler* scheduler_{}; /* 所属的调度器, 添加任务时的当前调度器 */
+    TaskId id_ = kNoTask;    /* 任务表下标, 也是冷数据的下标 */
     struct {
         uint8_t dynamic : 1;
-        uint8_t dynamicStack : 1;
-    } flags;
+        uint8_t dynamicStack : 1; /* 调用栈由栈池分配, 任务结束或扩展时归还 */
+#if PT_EXTEND_STATIC_TASK_SET
+        uint8_t staticSet : 1; /* 属于静态任务集, 就绪状态只记在ready上, 不进就绪队列 */
+#endif
+#if PT_EXTEND_ENABLE_PRIORITY || PT_EXTEND_ENABLE_EDF || PT_EXTEND_STATIC_TASK_SET
+        uint8_t ready : 1;
+#endif
+    } flags{}; /* 栈上/未清零的静态TCB也从全0开始 */
+    uint8_t waitState_{};  /* WaitState */
+    uint8_t waitResult_{}; /* WaitResult */
+#if PT_EXTEND_ENABLE_PRIORITY
+    uint8_t priority_{}; /* 越大越优先 */
+#endif
+#if PT_EXTEND_WORK_STEALING
+    std::atomic<uint8_t> runState_{}; /* RunState */
+#endif
+#if PT_EXTEND_ENABLE_EDF
+    uint32_t heapIndex_{};          /* 在截止时间堆里的下标 */
+    uint64_t deadline_{};           /* 本次就绪的绝对截止时间, steady_clock纳秒 */
+    uint32_t relativeDeadlineUs_{}; /* 0表示没有截止时间, 按FIFO在有截止时间的任务之后运行 */
+#endif
+};
 
-    void(*taskCode_)(void*);
-    void* userData_;
+/* 冷数据: 只在延时/等待/嵌套调用/结束/统计时访问 */
+struct TaskCold {
+    /* 延时结构使用单独的链接, 超时等待时任务可以同时挂在事件的等待链表上 */
+    TaskCold* timerNext_{};
+    TaskCold* timerPrev_{};
+    uint64_t wakeTick_{}; /* 绝对到期tick */
+    uint16_t wheelSlot_{};
+    TaskId id_ = kNoTask; /* 延时到期时找回PtExtend */
+    std::atomic<uint32_t> periodOverruns_{}; /* pt_extend_delay_until已经错过唤醒时刻的次数 */
+    PtEvent* waitEvent_{};
+    TaskGroup* group_{}; /* TaskGroup::Spawn的子任务, 结束时退出该组 */
+    bool suspended_{};   /* 在调度器的waitList_上, 由SuspendTask/ResumeTask修改 */
+    /* ResumeTaskFromISR投递, 由调度器线程在下一轮处理 */
+    TaskCold* inboxNext_{};
+    std::atomic<bool> inInbox_{};
     std::string_view name_;
 
 #if PT_EXTEND_NEST_SUPPORT
     pt* ptCallStack = nullptr;
+    uint32_t stackDepth_ = 0; /* 调用栈容量, pt_extend_call超出时扩展或报告溢出 */
+    std::atomic<uint32_t> stackHighWater_{}; /* 到达过的最大嵌套深度, 用来确定静态调用栈的大小 */
+#endif
+#if PT_EXTEND_ENABLE_EDF
+    std::atomic<uint32_t> deadlineMisses_{}; /* 离开就绪状态时已经超过截止时间的次数 */
 #endif
+#if PT_EXTEND_TASK_STATS
+    TaskStats stats_;
+#endif
+};
+
+// --------------------------------------------------------------------------------
+// 任务表
+// --------------------------------------------------------------------------------
+/*
+ * 按块增长, 块分配后不移动, 下标的高位是块号, 低位是块内位置.
+ * 动态任务的块里是连续的PtExtend数组和同样下标的userData数组/TaskCold数组;
+ * 静态任务的块里是指向用户TCB的指针和userData数组/TaskCold数组.
+ */
+static constexpr uint32_t kTaskChunkBits = 10;
+static constexpr uint32_t kTaskChunkSize = 1u << kTaskChunkBits;
+static constexpr uint32_t kTaskChunkMask = kTaskChunkSize - 1;
+static constexpr uint32_t kTaskTableMaxChunks = 1u << 14;
+static constexpr uint32_t kStaticTaskChunkBits = 6;
+static constexpr uint32_t kStaticTaskChunkSize = 1u << kStaticTaskChunkBits;
+static constexpr uint32_t kStaticTaskChunkMask = kStaticTaskChunkSize - 1;
+static constexpr uint32_t kStaticTaskMaxChunks = 1u << 10;
+
+struct TaskChunk {
+    PtExtend hot_[kTaskChunkSize];
+    void* userData_[kTaskChunkSize];
+    TaskCold cold_[kTaskChunkSize];
 };
 
+struct StaticTaskChunk {
+    PtExtend* hot_[kStaticTaskChunkSize];
+    void* userData_[kStaticTaskChunkSize];
+    TaskCold cold_[kStaticTaskChunkSize];
+};
+
+/* 块只在持有任务表锁时追加, 拿到下标的线程一定能看到对应的块 */
+extern TaskChunk* taskChunks[kTaskTableMaxChunks];
+extern StaticTaskChunk* staticTaskChunks[kStaticTaskMaxChunks];
+
+/* kNoTask返回nullptr */
+inline PtExtend* TaskAt(TaskId id) {
+    if (id & kStaticTaskBit) [[unlikely]] {
+        if (id == kNoTask) {
+            return nullptr;
+        }
+        id &= ~kStaticTaskBit;
+        return staticTaskChunks[id >> kStaticTaskChunkBits]->hot_[id & kStaticTaskChunkMask];
+    }
+    return &taskChunks[id >> kTaskChunkBits]->hot_[id & kTaskChunkMask];
+}
+
+/* 任务必须已经添加过 */
+inline TaskCold& TaskColdOf(const PtExtend& pt) {
+    TaskId id = pt.id_;
+    if (id & kStaticTaskBit) [[unlikely]] {
+        id &= ~kStaticTaskBit;
+        return staticTaskChunks[id >> kStaticTaskChunkBits]->cold_[id & kStaticTaskChunkMask];
+    }
+    return taskChunks[id >> kTaskChunkBits]->cold_[id & kTaskChunkMask];
+}
+
+/* 每次恢复任务时传给taskCode_, 8字节一个, 顺序遍历时和热数据一样连续 */
+inline void*& TaskUserData(const PtExtend& pt) {
+    TaskId id = pt.id_;
+    if (id & kStaticTaskBit) [[unlikely]] {
+        id &= ~kStaticTaskBit;
+        return staticTaskChunks[id >> kStaticTaskChunkBits]->userData_[id & kStaticTaskChunkMask];
+    }
+    return taskChunks[id >> kTaskChunkBits]->userData_[id & kTaskChunkMask];
+}
+
 }
 
 namespace pt_extend {
@@ -56,66 +304,281 @@ namespace pt_extend {
 // 引用链表
 // --------------------------------------------------------------------------------
 struct RefList {
-    PtExtend* head_;
-    PtExtend* tail_;
+    TaskId head_ = kNoTask;
+    TaskId tail_ = kNoTask;
 };
 void AddToListEnd(RefList& list, PtExtend* pt);
 void RemoveFromList(RefList& list, PtExtend* pt);
 PtExtend* PopFront(RefList& list);
-
-extern RefList preAwaitList;
+/* 取下前count个节点, 返回取下的那一串 */
+RefList PopFrontN(RefList& list, uint32_t count);
 
 /* config */
-static constexpr int kTickRate = 1000;
-static constexpr int Ms2Ticks(int ms) { return ms * kTickRate / 1000; }
-static constexpr int Ticks2Ms(int ticks) { return ticks * 1000 / kTickRate; }
+/* 超时参数小于0表示不超时 */
+static constexpr int64_t kWaitForever = -1;
+static constexpr uint32_t kDefaultTickUs = 1000;
+/* 一个tick的微秒数, 用SetTickResolution设置 */
+extern uint32_t tickResolutionUs;
+/* 向上取整, 不足一个tick的延时不会变成0 */
+inline int64_t Us2Ticks(int64_t us) {
+    return us < 0 ? kWaitForever : (us + tickResolutionUs - 1) / tickResolutionUs;
+}
+inline int64_t Ms2Ticks(int64_t ms) { return ms < 0 ? kWaitForever : Us2Ticks(ms * 1000); }
+inline int64_t Ticks2Us(int64_t ticks) { return ticks * tickResolutionUs; }
+inline int64_t Ticks2Ms(int64_t ticks) { return Ticks2Us(ticks) / 1000; }
+/* 1us~1s, 必须在调度器开始运行之前调用, 已经在计时的延时不会换算 */
+void SetTickResolution(uint32_t us);
+#if PT_EXTEND_TCB_POOL
+static constexpr uint32_t kTaskPoolCacheSize = 32;
+#endif
+#if PT_EXTEND_NEST_SUPPORT && PT_EXTEND_CALL_STACK_GROW
+/* 调用栈第一次扩展时的容量 */
+static constexpr uint32_t kCallStackMinDepth = 4;
+#endif
+#if PT_EXTEND_STACK_POOL
+/* 深度1~256共9级, 更深的直接new[] */
+static constexpr uint32_t kStackPoolClasses = 9;
+static constexpr uint32_t kStackPoolChunk = 16;
+#endif
+#if PT_EXTEND_COROUTINE_FRAME_POOL
+/* 以64字节为单位, 64B~16KB共9级, 更大的直接operator new */
+static constexpr uint32_t kFramePoolBlockSize = 64;
+static constexpr uint32_t kFramePoolClasses = 9;
+static constexpr uint32_t kFramePoolChunk = 16;
+#endif
+#if PT_EXTEND_EPOLL_REACTOR
+/* 一次epoll_wait最多取回的事件数 */
+static constexpr int kReactorMaxEvents = 256;
+#endif
+#if PT_EXTEND_IO_URING
+static constexpr uint32_t kIoRingEntries = 256;
+/* io_uring不可用时执行阻塞调用的线程数 */
+static constexpr uint32_t kIoPoolThreads = 4;
+#endif
 
-void RemoveFromReadyAddToWaitList(PtExtend* pt);
+void RemoveFromReadyAddToWaitList(PtExtend* pt, int64_t ticks);
 void RemoveFromWaitListAndAddToReady(PtExtend* pt);
+/* pt_extend_wait_timeout使用: 开始计时, 以及判断条件等待是否结束(条件满足或已超时) */
+void StartWaitCondition(int64_t timeoutTicks);
+bool FinishWaitCondition(bool cond);
 void RemoveFromReadyList(PtExtend* pt);
 void AddToReadyList(PtExtend* pt);
 
-PtExtend* GetCurrentTask();
-pt* GetCurrentCallPt();
+/* 线程的执行上下文: 当前任务和当前栈帧. 宏直接读取, 每次展开只需一次线程局部变量访问 */
+extern constinit thread_local PtExtend* pCurrentTask;
+extern constinit thread_local pt* pCurrentCallPt;
+#if PT_EXTEND_NEST_SUPPORT
+/* 协程函数嵌套 */
+extern constinit thread_local uint32_t nestingLevel;
+#endif
+
+inline PtExtend* GetCurrentTask() {
+    return pCurrentTask;
+}
+
+/* 当前任务正在执行的栈帧: 任务函数顶层是pt_, 嵌套时是ptCallStack[nestingLevel - 1] */
+inline pt* GetCurrentCallPt() {
+    return pCurrentCallPt;
+}
+
+/* 调度器切换到任务, 从任务函数顶层开始运行 */
+inline void SetCurrentTask(PtExtend& pt) {
+    pCurrentTask = &pt;
+    pCurrentCallPt = &pt.pt_;
+}
 
+#if PT_EXTEND_NEST_SUPPORT
+/* 当前任务的调用栈满了: 扩展后返回true; 溢出时陷入或返回false */
+bool GrowCallStack();
+/* 归还栈池分配的调用栈 */
+void ReleaseCallStack(PtExtend& pt);
+
+/* pt_extend_call进入前保证还有一个空闲栈帧 */
+inline bool ReserveCallFrame() {
+    return nestingLevel < TaskColdOf(*pCurrentTask).stackDepth_ || GrowCallStack();
+}
+
+/* pt_extend_call进入和离开被调用的函数 */
+inline void PushCallFrame() {
+    auto& cold = TaskColdOf(*pCurrentTask);
+    pCurrentCallPt = &cold.ptCallStack[nestingLevel++];
+    if (nestingLevel > cold.stackHighWater_.load(std::memory_order_relaxed)) {
+        cold.stackHighWater_.store(nestingLevel, std::memory_order_relaxed);
+    }
+}
+
+inline void PopCallFrame() {
+    --nestingLevel;
+    pCurrentCallPt = nestingLevel == 0 ? &pCurrentTask->pt_ : &TaskColdOf(*pCurrentTask).ptCallStack[nestingLevel - 1];
+}
+#endif
+
+/* 静态任务结束: 归还栈池分配的调用栈, 注销统计, 归还任务表下标, TCB之后可以释放或重新添加 */
+void StaticEndCurrent();
 #if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
 void DynamicDeleteCurrent();
+#if PT_EXTEND_TCB_POOL
+/* 预先扩展任务表, 保证至少有count个空闲的动态任务 */
+bool ReserveTaskPool(uint32_t count);
 #endif
-void SetCurrentTask(PtExtend& pt);
+#endif
+/* 协程帧分配, 失败返回nullptr */
+void* AllocateCoroutineFrame(size_t size);
+void FreeCoroutineFrame(void* frame, size_t size);
 
 /* public */
+/*
+ * 调度器实例: 就绪/延时/挂起队列, 投递收件箱和时钟都属于调度器, 不同调度器之间互不影响.
+ * 每个线程有一个当前调度器, AddStaticTask/AddDynamicTask添加到它, RunScheduler*运行它.
+ * 一个调度器同一时间只能在一个线程上运行, 任务和事件不能跨调度器直接Give(跨线程用GiveFromISR).
+ * epoll反应器和io_uring只服务默认调度器.
+ */
+/* 没有设置当前调度器的线程使用默认调度器 */
+Scheduler& DefaultScheduler();
+Scheduler& CurrentScheduler();
+/* nullptr恢复为默认调度器 */
+void SetCurrentScheduler(Scheduler* scheduler);
+#if !PT_EXTEND_WORK_STEALING
+/* 失败返回nullptr */
+Scheduler* CreateScheduler();
+/* 调度器必须已经停止, 剩下的任务不再运行, 动态任务不释放 */
+void DestroyScheduler(Scheduler* scheduler);
+/* 正在运行的RunScheduler*在本轮结束后返回, 可以在其他线程调用 */
+void StopScheduler(Scheduler& scheduler);
+#endif
+
+/* 推进当前调度器的时钟 */
 void TimerTick(uint32_t tickPlus);
+/* 每个调度器可以有自己的tick源, 可以在其他线程调用 */
+void TimerTick(Scheduler& scheduler, uint32_t tickPlus);
+/* 当前调度器的tick计数, 在任务里调用, 用来初始化pt_extend_delay_until的lastWake */
+uint64_t GetTickCount();
+/* pt_extend_delay_until使用: 计算下一个周期, 返回true表示需要延时到新的lastWake */
+bool DelayUntil(uint64_t& lastWake, int64_t periodTicks);
+/* 当前任务延时到第tick个tick需要的延时, 已经过了返回0 */
+int64_t TicksUntil(uint64_t tick);
+/* 冷数据随任务结束归还, 已经结束的静态任务返回0 */
+inline uint32_t GetPeriodOverruns(const PtExtend& pt) {
+    return pt.id_ == kNoTask ? 0 : TaskColdOf(pt).periodOverruns_.load(std::memory_order_relaxed);
+}
+#if PT_EXTEND_TICKLESS_IDLE
+/* 调度器的时钟源, 返回单调递增的纳秒数 */
+using ClockSource = uint64_t (*)();
+/* 默认时钟源, 读取CLOCK_MONOTONIC */
+uint64_t MonotonicNowNs();
+/* 替换时钟源(仿真/测试), 必须在调度器开始运行之前调用 */
+void SetClockSource(ClockSource source);
+/* 唤醒正在空闲睡眠的调度器, 可以在其他线程调用 */
+void WakeScheduler();
+void WakeScheduler(Scheduler& scheduler);
+#endif
+#if PT_EXTEND_WORK_STEALING
+/* 工作窃取任务状态 */
+enum RunState : uint8_t {
+    kRunStateParked,
+    kRunStateReady,
+    kRunStateRunning,
+    kRunStateRunningWoken,
+};
+static constexpr uint32_t kWorkStealingDequeSize = 1u << 14;
+
+void LockScheduler();
+void UnlockScheduler();
+/* 调用线程作为0号worker, 另外启动workerCount-1个线程, 直到StopSchedulerWorkStealing */
+void RunSchedulerWorkStealing(uint32_t workerCount);
+void StopSchedulerWorkStealing();
+#else
 /* 可以使用pt_extend_wait直接等待普通变量 */
 void RunSchedulerNoPriority();
+#endif
+#if PT_EXTEND_STATIC_TASK_SET
+/* 每轮先调用staticPass运行静态任务集, 再运行就绪队列里的其他任务 */
+void RunSchedulerStatic(void (*staticPass)());
+#if PT_EXTEND_TASK_STATS
+/* 静态任务集直接调用任务时记录统计 */
+uint64_t TaskStatsNow();
+void RecordTaskResume(PtExtend& pt, uint64_t ns);
+#endif
+#endif
+#if PT_EXTEND_ENABLE_PRIORITY
+static constexpr uint32_t kPriorityLevels = 32;
+/* 总是运行最高优先级的就绪任务, 同优先级轮转, 低优先级只在高优先级都不就绪时运行 */
+void RunScheduler();
+void SetTaskPriority(PtExtend& pt, uint32_t priority);
+#endif
+#if PT_EXTEND_ENABLE_EDF
+/*
+ * 总是运行截止时间最早的就绪任务, 没有截止时间的任务只在它们都不就绪时轮转运行.
+ * 任务从不就绪变为就绪(添加/延时到期/事件唤醒/恢复)时截止时间为当前时间加相对截止时间,
+ * yield不改变截止时间, 所以有截止时间的任务应当用延时/事件等待而不是pt_extend_wait轮询.
+ * 离开就绪状态(延时/等待/挂起/结束)时超过截止时间记一次deadlineMisses_.
+ */
+void RunSchedulerEdf();
+/* 周期任务使用周期作为相对截止时间, 0表示没有截止时间; 添加任务之前设置时第一次就绪就生效 */
+void SetTaskDeadline(PtExtend& pt, uint32_t relativeDeadlineUs);
+/* 同GetPeriodOverruns, 已经结束的静态任务返回0 */
+inline uint32_t GetDeadlineMisses(const PtExtend& pt) {
+    return pt.id_ == kNoTask ? 0 : TaskColdOf(pt).deadlineMisses_.load(std::memory_order_relaxed);
+}
+#endif
 
-#if PT_EXTEND_NEST_SUPPORT
-void AddStaticTask(PtExtend& staticTCB, std::string_view name, void(*code)(void* userData), pt* ptCallStack, void* userData = nullptr);
-#else
+/* 静态TCB添加时登记到任务表, 任务结束(pt_extend_end)时归还下标, 在那之前TCB要一直有效 */
+/* 不带调用栈的任务第一次pt_extend_call时从栈池分配, 之后按需扩展 */
 void AddStaticTask(PtExtend& staticTCB, std::string_view name, void(*code)(void* userData), void* userData = nullptr);
+#if PT_EXTEND_NEST_SUPPORT
+/* ptCallStack至少有stackDepth个栈帧, 嵌套更深时换成栈池分配的栈, 原来的栈不再使用 */
+void AddStaticTask(PtExtend& staticTCB, std::string_view name, void(*code)(void* userData), pt* ptCallStack, uint32_t stackDepth, void* userData = nullptr);
 #endif
+/* 旧的(..., ptCallStack[, userData])形式没有栈深度, 调用栈会被当成userData, 禁止编译; 只匹配pt*, nullptr仍是userData */
+template<std::same_as<pt*> Stack>
+void AddStaticTask(PtExtend& staticTCB, std::string_view name, void(*code)(void* userData), Stack ptCallStack) = delete;
+template<std::same_as<pt*> Stack>
+void AddStaticTask(PtExtend& staticTCB, std::string_view name, void(*code)(void* userData), Stack ptCallStack, void* userData) = delete;
 #if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
+PtExtend* AddDynamicTask(std::string_view name, void(*code)(void* userData), void* userData = nullptr);
 #if PT_EXTEND_NEST_SUPPORT
-PtExtend* AddDynamicTask(std::string_view name, void(*code)(void* userData), pt* ptCallStack, void* userData = nullptr);
+PtExtend* AddDynamicTask(std::string_view name, void(*code)(void* userData), pt* ptCallStack, uint32_t stackDepth, void* userData = nullptr);
+/* 预先从栈池分配stackDepth个栈帧 */
 PtExtend* AddDynamicTask(std::string_view name, void(*code)(void* userData), uint32_t stackDepth, void* userData = nullptr);
-#else
-PtExtend* AddDynamicTask(std::string_view name, void(*code)(void* userData), void* userData = nullptr);
 #endif
+template<std::same_as<pt*> Stack>
+PtExtend* AddDynamicTask(std::string_view name, void(*code)(void* userData), Stack ptCallStack) = delete;
+template<std::same_as<pt*> Stack>
+PtExtend* AddDynamicTask(std::string_view name, void(*code)(void* userData), Stack ptCallStack, void* userData) = delete;
 #endif
 
+/* 工作窃取模式下只能挂起当前任务 */
 void SuspendTask(PtExtend& pt);
+/* 在任务所属调度器的线程调用(工作窃取时任意worker), 没有挂起的任务不受影响 */
 void ResumeTask(PtExtend& pt);
+/* 任意线程/中断可调用, 无锁, 调度器线程在下一轮ResumeTask; 在那之前任务不能结束 */
+void ResumeTaskFromISR(PtExtend& pt);
 
-#if PT_EXTEND_COUNT_TASK_TICKS
-void PrintTaskTicks();
+#if PT_EXTEND_TASK_STATS
+struct TaskStatsSnapshot {
+    std::string_view name_;
+    uint64_t cpuNs_;
+    uint64_t resumes_;
+    uint64_t maxNs_;
+    uint32_t histogram_[kTaskStatsBuckets];
+};
+/* 任意线程可调用, 不需要停止调度器 */
+std::vector<TaskStatsSnapshot> SnapshotTaskStats();
+void PrintTaskStats();
 #endif
 
-#if PT_EXTEND_NEST_SUPPORT
-/* 协程函数嵌套 */
-extern uint32_t nestingLevel;
-#endif
+/* 函数在协程里的位置, 由开始宏在函数内声明kPtExtendFrame, 延时/结束据此省去运行时判断 */
+enum FrameKind : uint8_t {
+    kFrameUnknown, /* pt_extend_begin: 运行时用nestingLevel判断 */
+    kFrameTask,    /* pt_extend_task_begin: 任务函数顶层 */
+    kFrameNested,  /* pt_extend_nest_begin: 只被pt_extend_call调用 */
+};
 
 }
 
+/* 没有用task/nest开始宏的函数看到的是这个 */
+static constexpr pt_extend::FrameKind kPtExtendFrame = pt_extend::kFrameUnknown;
+
 // --------------------------------------------------------------------------------
 // 阻止重复label
 // --------------------------------------------------------------------------------
@@ -155,41 +618,61 @@ extern uint32_t nestingLevel;
 // --------------------------------------------------------------------------------
 // Delay
 // --------------------------------------------------------------------------------
-/* 协程延时 */
-#define pt_extend_co_delay(ms)\
+/* 协程延时, 单位tick */
+#define pt_extend_co_delay_ticks(ticks)\
     do {\
-        pt_extend::GetCurrentTask()->delay_ = (pt_extend::Ms2Ticks((ms)));\
-        pt_extend::RemoveFromReadyAddToWaitList(pt_extend::GetCurrentTask());\
+        pt_extend::RemoveFromReadyAddToWaitList(pt_extend::GetCurrentTask(), (ticks));\
         pt_label(&pt_extend::GetCurrentTask()->pt_, PT_STATUS_YIELDED); \
         if (pt_status(&pt_extend::GetCurrentTask()->pt_) == PT_STATUS_YIELDED) {\
+            pt_extend::GetCurrentTask()->pt_.status = PT_STATUS_BLOCKED;\
             return;\
         }\
     } while (0)
 
 #if PT_EXTEND_NEST_SUPPORT
-/* 协程嵌套延时 */
-#define pt_extend_nest_delay(ms)\
+/* 协程嵌套延时, 单位tick */
+#define pt_extend_nest_delay_ticks(ticks)\
     do {\
-        pt_extend::GetCurrentTask()->delay_ = (pt_extend::Ms2Ticks((ms)));\
-        pt_extend::RemoveFromReadyAddToWaitList(pt_extend::GetCurrentTask());\
+        pt_extend::RemoveFromReadyAddToWaitList(pt_extend::GetCurrentTask(), (ticks));\
         pt_extend::GetCurrentTask()->pt_.status = PT_STATUS_YIELDED;\
         _pt_extend_unduplicate_label(pt_extend::GetCurrentCallPt(), PT_STATUS_BLOCKED);\
         if (pt_status(&pt_extend::GetCurrentTask()->pt_) == PT_STATUS_YIELDED) {\
+            pt_extend::GetCurrentTask()->pt_.status = PT_STATUS_BLOCKED;\
             return;\
         }\
     } while(0)
 
-/* 通用延时 */
-#define pt_extend_delay(ms)\
-    if (pt_extend::nestingLevel != 0) {\
-        pt_extend_nest_delay(ms);\
+/* 当前函数是否是嵌套函数, 用task/nest开始宏时是编译期常量 */
+#define _pt_extend_in_nest()\
+    (kPtExtendFrame == pt_extend::kFrameNested || (kPtExtendFrame == pt_extend::kFrameUnknown && pt_extend::nestingLevel != 0))
+
+/* 通用延时, 单位tick */
+#define pt_extend_delay_ticks(ticks)\
+    if (_pt_extend_in_nest()) {\
+        pt_extend_nest_delay_ticks(ticks);\
     }\
     else {\
-        pt_extend_co_delay(ms);\
+        pt_extend_co_delay_ticks(ticks);\
     }
+#define pt_extend_nest_delay(ms) pt_extend_nest_delay_ticks(pt_extend::Ms2Ticks((ms)))
 #else
-#define pt_extend_delay(ms) pt_extend_co_delay(ms)
+#define pt_extend_delay_ticks(ticks) pt_extend_co_delay_ticks(ticks)
 #endif
+#define pt_extend_co_delay(ms) pt_extend_co_delay_ticks(pt_extend::Ms2Ticks((ms)))
+/* 通用延时, 单位毫秒/微秒, 按tick精度向上取整 */
+#define pt_extend_delay(ms) pt_extend_delay_ticks(pt_extend::Ms2Ticks((ms)))
+#define pt_extend_delay_us(us) pt_extend_delay_ticks(pt_extend::Us2Ticks((us)))
+
+/*
+ * 周期延时: 在lastWake + period的tick醒来, 醒来的时刻不随任务运行时间和调度抖动漂移.
+ * lastWake是uint64_t, 用GetTickCount()初始化后由宏更新, 必须跨yield保存.
+ * 已经错过唤醒时刻时不睡眠, 直接对齐到最近的周期边界(错过的周期不补跑), 并记一次periodOverruns_.
+ */
+#define pt_extend_delay_until_ticks(lastWake, periodTicks)\
+    if (pt_extend::DelayUntil((lastWake), (periodTicks))) {\
+        pt_extend_delay_ticks(pt_extend::TicksUntil((lastWake)));\
+    }
+#define pt_extend_delay_until(lastWake, periodMs) pt_extend_delay_until_ticks(lastWake, pt_extend::Ms2Ticks((periodMs)))
 
 // --------------------------------------------------------------------------------
 // Begin
@@ -200,6 +683,18 @@ extern uint32_t nestingLevel;
         pt_begin(pt_extend::GetCurrentCallPt());\
     } while (0)
 
+/* 只作为任务运行的函数开始, 延时/结束在编译期确定走任务顶层的分支 */
+#define pt_extend_task_begin()\
+    [[maybe_unused]] static constexpr pt_extend::FrameKind kPtExtendFrame = pt_extend::kFrameTask;\
+    pt_extend_begin()
+
+#if PT_EXTEND_NEST_SUPPORT
+/* 只被pt_extend_call调用的函数开始 */
+#define pt_extend_nest_begin()\
+    [[maybe_unused]] static constexpr pt_extend::FrameKind kPtExtendFrame = pt_extend::kFrameNested;\
+    pt_extend_begin()
+#endif
+
 // --------------------------------------------------------------------------------
 // End
 // --------------------------------------------------------------------------------
@@ -207,6 +702,7 @@ extern uint32_t nestingLevel;
 #define pt_extend_co_static_end()\
     do {\
         pt_extend::RemoveFromReadyList(pt_extend::GetCurrentTask());\
+        pt_extend::StaticEndCurrent();\
         pt_end(&pt_extend::GetCurrentTask()->pt_);\
     } while (0)
 
@@ -240,7 +736,7 @@ extern uint32_t nestingLevel;
 
 /* 通用结束 */
 #define pt_extend_end()\
-    if (pt_extend::nestingLevel != 0) {\
+    if (_pt_extend_in_nest()) {\
         pt_extend_nest_end();\
     }\
     else {\
@@ -259,9 +755,22 @@ extern uint32_t nestingLevel;
 // --------------------------------------------------------------------------------
 // Wait
 // --------------------------------------------------------------------------------
-/* 协程/嵌套等待 */
+/* 协程/嵌套等待, 任务留在就绪队列里每轮重新检查; 很少变化的条件用pt_wait_queue_wait */
 #define pt_extend_wait(cond) pt_wait(pt_extend::GetCurrentCallPt(), cond);
 
+/* 超时等待条件, 仍然每轮轮询, 之后用pt_extend_timed_out()判断结果 */
+#define pt_extend_wait_timeout(cond, ms)\
+    do {\
+        pt_extend::StartWaitCondition(pt_extend::Ms2Ticks((ms)));\
+        pt_label(pt_extend::GetCurrentCallPt(), PT_STATUS_BLOCKED);\
+        if (!pt_extend::FinishWaitCondition((cond))) {\
+            return;\
+        }\
+    } while (0)
+
+/* 上一次超时等待是否因为超时而结束 */
+#define pt_extend_timed_out() (pt_extend::GetCurrentTask()->waitResult_ == pt_extend::kWaitTimeout)
+
 // --------------------------------------------------------------------------------
 // Suspend
 // --------------------------------------------------------------------------------
@@ -276,20 +785,25 @@ extern uint32_t nestingLevel;
 // Call
 // --------------------------------------------------------------------------------
 #if PT_EXTEND_NEST_SUPPORT
-/* 协程/协程函数调用协程函数 */
+/* 协程/协程函数调用协程函数, 被调用的栈帧在第一次进入时才初始化.
+ * 调用栈满了且不能扩展时停在调用处, 每轮重试 */
 #define pt_extend_call_begin()\
     do {\
+        if (!pt_extend::ReserveCallFrame()) [[unlikely]] {\
+            _pt_extend_unduplicate_wait(pt_extend::GetCurrentCallPt(), pt_extend::ReserveCallFrame());\
+        }\
+        pt_extend::TaskColdOf(*pt_extend::GetCurrentTask()).ptCallStack[pt_extend::nestingLevel] = pt_init();\
         pt_label(pt_extend::GetCurrentCallPt(), PT_STATUS_BLOCKED);\
-        ++pt_extend::nestingLevel;\
+        pt_extend::PushCallFrame();\
     } while(0)
 
 #define pt_extend_call_end()\
     do {\
         if (pt_status(pt_extend::GetCurrentCallPt()) != PT_STATUS_FINISHED) {\
-            --pt_extend::nestingLevel;\
+            pt_extend::PopCallFrame();\
             return;\
         }\
-        --pt_extend::nestingLevel;\
+        pt_extend::PopCallFrame();\
     } while(0)
 
 #define pt_extend_call(func, ...)\
@@ -303,40 +817,274 @@ extern uint32_t nestingLevel;
 // --------------------------------------------------------------------------------
 namespace pt_extend {
 
+/* 计数信号量 */
 struct PtEvent {
-    volatile int32_t num_{};
-    RefList list_;
+    std::atomic<int32_t> count_{}; /* >0可用计数, <0等待的任务数 */
+    RefList list_{};
+    Scheduler* scheduler_{}; /* GiveFromISR投递到的调度器, nullptr为默认调度器 */
 
-    void Give() {
-        ++num_;
-        auto* p = PopFront(list_);
-        if (p) {
-            AddToReadyList(p);
+    /* GiveFromISR投递, 由调度器线程在下一轮处理 */
+    PtEvent* inboxNext_{};
+    std::atomic<uint32_t> pendingGives_{};
+    std::atomic<bool> inInbox_{};
+
+    /* 有可用计数时无锁取走一个 */
+    bool TryTake() {
+        int32_t count = count_.load(std::memory_order_relaxed);
+        while (count > 0) {
+            if (count_.compare_exchange_weak(count, count - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
         }
+        return false;
     }
 
-    void GiveFromISR() {
-        ++num_;
-        auto* p = PopFront(list_);
-        if (p) {
-            AddToListEnd(preAwaitList, p);
-        }
+    /* 取一个计数, 取不到时把当前任务挂到list_上并返回true, 之后由Give转交计数并唤醒.
+     * timeoutTicks >= 0时同时放进延时结构, 超时先到则从list_上摘下并归还占用的计数 */
+    bool TakeOrPark(int64_t timeoutTicks = kWaitForever);
+
+    void Give() {
+        GiveN(1);
     }
+
+    /* 释放n个计数, 最多唤醒n个等待的任务, 一次放回就绪队列 */
+    void GiveN(uint32_t n);
+
+    /* 任意线程/中断可调用, 无锁; 无tick空闲时唤醒调度器在Linux上用futex, 也可以在信号处理函数里调用 */
+    void GiveFromISR();
 };
 
 #define pt_event_take(e)\
     do {\
-        for (;;) {\
-            volatile int32_t b = --(e).num_;\
-            if (b == (e).num_) {\
-                if (b < 0) {\
-                    pt_extend::RemoveFromReadyList(pt_extend::GetCurrentTask());\
-                    pt_extend::AddToListEnd(e.list_, pt_extend::GetCurrentTask());\
-                    pt_extend_yeild();\
-                    break;\
-                }\
-            }\
+        if (!(e).TryTake() && (e).TakeOrPark()) {\
+            pt_extend_yeild();\
+        }\
+    } while(0)
+
+/* 超时等待事件, 之后用pt_extend_timed_out()判断结果 */
+#define pt_event_take_timeout(e, ms)\
+    do {\
+        pt_extend::GetCurrentTask()->waitResult_ = pt_extend::kWaitSignaled;\
+        if (!(e).TryTake() && (e).TakeOrPark(pt_extend::Ms2Ticks((ms)))) {\
+            pt_extend_yeild();\
         }\
     } while(0)
 
+// --------------------------------------------------------------------------------
+// Wait Queue
+// --------------------------------------------------------------------------------
+/*
+ * 等待任意条件: pt_wait_queue_wait条件不满足时挂到队列上并离开就绪队列,
+ * 改变条件的一方调用Notify, 全部等待者回到就绪队列重新检查, 仍不满足的再次挂起.
+ * 检查条件之前先读epoch_, 挂起时epoch_已经变了说明检查期间有Notify, 不挂起下一轮重新检查.
+ * Notify在调度器线程(工作窃取时任意worker)调用, 等待者需要属于同一个调度器.
+ */
+struct WaitQueue {
+    RefList list_{};
+    std::atomic<uint32_t> epoch_{};   /* 每次Notify加1 */
+    std::atomic<uint32_t> waiters_{}; /* 没有等待者时Notify不进临界区 */
+
+    uint32_t Epoch() const {
+        return epoch_.load();
+    }
+
+    /* 检查条件之后epoch_没有变时挂起当前任务并返回true */
+    bool ParkIfUnchanged(uint32_t epoch);
+
+    /* 唤醒所有等待者 */
+    void Notify();
+};
+
+#define pt_wait_queue_wait(q, cond)\
+    do {\
+        pt_label(pt_extend::GetCurrentCallPt(), PT_STATUS_BLOCKED);\
+        uint32_t _pt_wait_queue_epoch = (q).Epoch();\
+        if (!(cond)) {\
+            (q).ParkIfUnchanged(_pt_wait_queue_epoch);\
+            return;\
+        }\
+    } while (0)
+
+#if PT_EXTEND_ENABLE_DYNAMIC_ALLOC
+// --------------------------------------------------------------------------------
+// Task Group
+// --------------------------------------------------------------------------------
+/*
+ * fork-join: Spawn的子任务在pt_extend_end时退出组, 父任务用pt_task_group_join挂起到全部退出,
+ * 等待期间不在就绪队列里, 由最后一个退出的子任务唤醒. Join之后可以继续Spawn复用.
+ * 屏障: 组内还没退出的子任务都到达pt_task_group_barrier后一起继续, 已退出的不再计入.
+ * 父任务进入pt_task_group_join后组才封闭, 屏障才开始放行, 所以Spawn期间先运行的子任务不会单独通过.
+ * 子任务加入当前调度器, 父任务和子任务需要在同一个调度器(或工作窃取调度器)上.
+ */
+struct TaskGroup {
+    /* 未退出的子任务数加上父任务持有的1, Join时放下, 减到0的一方负责恢复为1 */
+    std::atomic<uint32_t> live_{1};
+    PtEvent done_;
+
+    /* 屏障状态在临界区内修改 */
+    uint32_t members_{}; /* 未退出的子任务数 */
+    uint32_t arrived_{};
+    bool sealed_{};      /* 父任务在Join中, 成员不会再增加 */
+    std::atomic<uint32_t> phase_{};
+    /* 按phase_奇偶交替, 先进入下一阶段的任务拿不走本阶段的唤醒 */
+    PtEvent barrier_[2];
+
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /* 失败返回nullptr */
+    PtExtend* Spawn(std::string_view name, void(*code)(void* userData), void* userData = nullptr);
+#if PT_EXTEND_NEST_SUPPORT
+    PtExtend* Spawn(std::string_view name, void(*code)(void* userData), uint32_t stackDepth, void* userData = nullptr);
+#endif
+
+    /* 已经完成的屏障阶段数 */
+    uint32_t Phase() const { return phase_.load(std::memory_order_acquire); }
+
+    /* 子任务都已退出时返回false, 否则挂起当前任务并返回true */
+    bool JoinOrPark();
+    /* 最后一个到达时放行本阶段并返回false, 否则挂起当前任务并返回true */
+    bool ArriveOrPark();
+    /* 子任务结束时由DynamicDeleteCurrent调用 */
+    void Leave();
+};
+
+/* 父任务等待组内所有子任务结束 */
+#define pt_task_group_join(g)\
+    do {\
+        if ((g).JoinOrPark()) {\
+            pt_extend_yeild();\
+        }\
+    } while(0)
+
+/* 子任务等待组内其他子任务到达同一阶段 */
+#define pt_task_group_barrier(g)\
+    do {\
+        if ((g).ArriveOrPark()) {\
+            pt_extend_yeild();\
+        }\
+    } while(0)
+#endif
+
+#if PT_EXTEND_EPOLL_REACTOR
+// --------------------------------------------------------------------------------
+// Reactor
+// --------------------------------------------------------------------------------
+enum FdInterest : uint32_t {
+    kFdReadable = 1,
+    kFdWritable = 2,
+};
+
+/*
+ * 边沿触发: fd只注册一次, epoll报告的就绪边沿没有等待者时锁存在ready_里.
+ * 任务读写到EAGAIN后再等待, 等待消费一个边沿, 所以锁存的旧边沿最多多试一次.
+ */
+struct PtFd {
+    int fd_ = -1;
+    uint32_t ready_{}; /* 锁存的FdInterest */
+    PtExtend* readWaiter_{};
+    PtExtend* writeWaiter_{};
+    bool closed_{};
+    PtFd* retireNext_{};
+
+    /* 有锁存的边沿时消费掉并返回false, 否则把当前任务挂起等待并返回true.
+     * interest是kFdReadable或kFdWritable之一, 每个方向同时只能有一个任务等待 */
+    bool WaitOrPark(uint32_t interest);
+};
+
+/* 注册一个已经设为非阻塞的fd, 失败返回nullptr(errno有效), 当前调度器不是默认调度器时errno为EINVAL.
+ * 只有默认调度器上的任务可以等待, 其他调度器上等待会abort */
+PtFd* OpenFd(int fd);
+/* 注销, 不关闭fd. 调用时不能有任务在等待f, 之后不能再使用f */
+void CloseFd(PtFd* f);
+
+#define pt_fd_wait_readable(f)\
+    do {\
+        if ((f).WaitOrPark(pt_extend::kFdReadable)) {\
+            pt_extend_yeild();\
+        }\
+    } while(0)
+
+#define pt_fd_wait_writable(f)\
+    do {\
+        if ((f).WaitOrPark(pt_extend::kFdWritable)) {\
+            pt_extend_yeild();\
+        }\
+    } while(0)
+#endif
+
+#if PT_EXTEND_IO_URING
+// --------------------------------------------------------------------------------
+// Async I/O
+// --------------------------------------------------------------------------------
+enum IoOp : uint8_t {
+    kIoRead,
+    kIoWrite,
+    kIoAccept,
+    kIoFsync,
+};
+
+/* 一次异步操作, 完成前必须保持有效, 所以不能放在协程函数的局部变量里 */
+struct PtIo {
+    uint8_t op_{};   /* IoOp */
+    int fd_ = -1;
+    void* buf_{};    /* accept时是sockaddr* */
+    uint32_t len_{};
+    int64_t offset_{}; /* 小于0表示使用当前文件位置 */
+    socklen_t* addrLen_{};
+    uint32_t flags_{}; /* accept4的flags / IORING_FSYNC_DATASYNC */
+    int32_t result_{}; /* 同系统调用的返回值, 失败为-errno */
+    PtExtend* waiter_{};
+    PtIo* inboxNext_{}; /* 线程池执行时的队列/完成投递 */
+};
+
+/* 提交并挂起当前任务, 完成时放回就绪队列. 同一轮的提交在本轮结束时一次io_uring_enter.
+ * 只有默认调度器上的任务可以提交, 其他调度器上提交会abort */
+void SubmitIo(PtIo& io);
+
+inline void PrepareIo(PtIo& io, IoOp op, int fd, void* buf = nullptr, uint32_t len = 0, int64_t offset = -1) {
+    io.op_ = op;
+    io.fd_ = fd;
+    io.buf_ = buf;
+    io.len_ = len;
+    io.offset_ = offset;
+}
+
+#define pt_io_submit(io)\
+    do {\
+        pt_extend::SubmitIo((io));\
+        pt_extend_yeild();\
+    } while(0)
+
+/* 以下完成后结果在io.result_ */
+#define pt_io_read(io, fd, buf, len, offset)\
+    do {\
+        pt_extend::PrepareIo((io), pt_extend::kIoRead, (fd), (buf), (len), (offset));\
+        pt_io_submit(io);\
+    } while(0)
+
+#define pt_io_write(io, fd, buf, len, offset)\
+    do {\
+        pt_extend::PrepareIo((io), pt_extend::kIoWrite, (fd), const_cast<void*>(static_cast<const void*>(buf)), (len), (offset));\
+        pt_io_submit(io);\
+    } while(0)
+
+/* addr/addrLen可以为nullptr, flags同accept4 */
+#define pt_io_accept(io, fd, addr, addrLen, flags)\
+    do {\
+        pt_extend::PrepareIo((io), pt_extend::kIoAccept, (fd), (addr));\
+        (io).addrLen_ = (addrLen);\
+        (io).flags_ = (flags);\
+        pt_io_submit(io);\
+    } while(0)
+
+#define pt_io_fsync(io, fd)\
+    do {\
+        pt_extend::PrepareIo((io), pt_extend::kIoFsync, (fd));\
+        (io).flags_ = 0;\
+        pt_io_submit(io);\
+    } while(0)
+#endif
+
 }
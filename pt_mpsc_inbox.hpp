@@ -0,0 +1,43 @@
+/*
+ * Intrusive MPSC Inbox
+ * 任意线程(包括信号处理函数)无锁Push, 消费者一次exchange取走全部
+ * Node需要提供 inboxNext_
+*/
+
+#pragma once
+#include <atomic>
+
+namespace pt_extend {
+
+template<class Node>
+class MpscInbox {
+public:
+    void Push(Node* node) {
+        Node* head = head_.load(std::memory_order_relaxed);
+        do {
+            node->inboxNext_ = head;
+        } while (!head_.compare_exchange_weak(head, node, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    /* 取走全部节点, 按Push顺序返回链表头 */
+    Node* PopAll() {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        Node* fifo = nullptr;
+        while (node) {
+            auto* next = node->inboxNext_;
+            node->inboxNext_ = fifo;
+            fifo = node;
+            node = next;
+        }
+        return fifo;
+    }
+
+    bool Empty() const {
+        return head_.load(std::memory_order_relaxed) == nullptr;
+    }
+
+private:
+    std::atomic<Node*> head_{nullptr};
+};
+
+}
@@ -0,0 +1,83 @@
+/*
+ * Object Pool
+ * SizeClassPool: 按2的幂分级的数组池, 每级一个空闲链表, 按块增长, 块只在析构时释放
+*/
+
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace pt_extend {
+
+/* 只用于平凡类型的数组, 不调用构造/析构, 由使用者自己初始化 */
+template<class T, uint32_t kClasses>
+class SizeClassPool {
+public:
+    static_assert(std::is_trivially_destructible_v<T>);
+    static_assert(sizeof(T) >= sizeof(void*));
+    static constexpr uint32_t kMaxCount = 1u << (kClasses - 1);
+
+    explicit SizeClassPool(uint32_t chunkBlocks)
+        : chunkBlocks_(chunkBlocks) {
+    }
+
+    SizeClassPool(const SizeClassPool&) = delete;
+    SizeClassPool& operator=(const SizeClassPool&) = delete;
+
+    /* 向上取到2的幂, 超过kMaxCount返回0 */
+    static constexpr uint32_t RoundCount(uint32_t count) {
+        if (count == 0) {
+            count = 1;
+        }
+        uint32_t rounded = std::bit_ceil(count);
+        return rounded > kMaxCount ? 0 : rounded;
+    }
+
+    /* count必须是RoundCount的结果 */
+    T* Allocate(uint32_t count) {
+        auto& c = classes_[std::countr_zero(count)];
+        if (c.free == nullptr && !Grow(c, count)) {
+            return nullptr;
+        }
+        auto* block = c.free;
+        c.free = block->next;
+        return reinterpret_cast<T*>(block);
+    }
+
+    void Free(T* p, uint32_t count) {
+        auto& c = classes_[std::countr_zero(count)];
+        auto* block = ::new (static_cast<void*>(p)) FreeBlock{c.free};
+        c.free = block;
+    }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    struct Class {
+        FreeBlock* free = nullptr;
+        std::vector<std::unique_ptr<T[]>> chunks;
+    };
+
+    bool Grow(Class& c, uint32_t count) {
+        std::unique_ptr<T[]> chunk{new(std::nothrow) T[count * chunkBlocks_]};
+        if (!chunk) {
+            return false;
+        }
+        for (uint32_t i = chunkBlocks_; i-- != 0;) {
+            c.free = ::new (static_cast<void*>(&chunk[i * count])) FreeBlock{c.free};
+        }
+        c.chunks.push_back(std::move(chunk));
+        return true;
+    }
+
+    uint32_t chunkBlocks_;
+    Class classes_[kClasses];
+};
+
+}
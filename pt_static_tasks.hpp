@@ -0,0 +1,138 @@
+/*
+ * Compile-time Static Task Set
+ * 编译期确定的任务集合: TCB和嵌套调用栈都是连续的静态数组, 不使用堆
+ * 每轮按声明顺序检查ready位并直接调用任务函数, 没有链表遍历和函数指针, 可以内联
+ * 需要PT_EXTEND_STATIC_TASK_SET, 集合外的任务(AddStaticTask/AddDynamicTask)照常在每轮之后运行
+ * 集合在Start时加入当前调度器, 由运行它的RunSchedulerStatic调度
+ *
+ * void Blink(void*);
+ * void Shell(void*);
+ * using AppTasks = pt_extend::StaticTaskSet<
+ *     pt_extend::StaticTask<"blink", Blink>,
+ *     pt_extend::StaticTask<"shell", Shell, 4>>;
+ * AppTasks::Run();
+*/
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include "pt_extend2.hpp"
+
+#if !PT_EXTEND_STATIC_TASK_SET
+#error "pt_static_tasks.hpp requires PT_EXTEND_STATIC_TASK_SET"
+#endif
+
+namespace pt_extend {
+
+/* 可以作为模板参数的任务名 */
+template<size_t N>
+struct TaskName {
+    char str_[N]{};
+
+    constexpr TaskName(const char (&str)[N]) {
+        std::copy_n(str, N, str_);
+    }
+
+    constexpr std::string_view View() const { return {str_, N - 1}; }
+};
+
+/* kStackDepth: 静态调用栈深度, 嵌套更深或为0时第一次pt_extend_call从栈池分配 */
+template<TaskName kName, void (*kCode)(void*), uint32_t kStackDepth = 0>
+struct StaticTask {
+    static constexpr std::string_view name_ = kName.View();
+    static constexpr auto code_ = kCode;
+    static constexpr uint32_t stackDepth_ = kStackDepth;
+};
+
+template<class... Tasks>
+class StaticTaskSet {
+public:
+    static constexpr size_t kTaskCount = sizeof...(Tasks);
+    static constexpr uint32_t kStackDepth = (Tasks::stackDepth_ + ... + 0);
+
+    template<size_t I>
+    static PtExtend& Tcb() { return tcbs_[I]; }
+
+    /* 第I个任务的userData, 在Start之前设置 */
+    template<size_t I>
+    static void*& UserData() { return userData_[I]; }
+
+    /* 全部置为就绪 */
+    static void Start() { StartAll(std::index_sequence_for<Tasks...>{}); }
+
+    /* 按声明顺序运行一次所有就绪的任务 */
+    static void RunPass() { RunAll(std::index_sequence_for<Tasks...>{}); }
+
+    static void Run() {
+        Start();
+        RunSchedulerStatic(&RunPass);
+    }
+
+private:
+    template<size_t I>
+    using TaskAt = std::tuple_element_t<I, std::tuple<Tasks...>>;
+
+    /* 第index个任务的调用栈在stacks_里的起点 */
+    static constexpr uint32_t StackOffset(size_t index) {
+        constexpr uint32_t depths[] = {Tasks::stackDepth_..., 0};
+        uint32_t offset = 0;
+        for (size_t i = 0; i < index; i++) {
+            offset += depths[i];
+        }
+        return offset;
+    }
+
+    template<size_t... I>
+    static void StartAll(std::index_sequence<I...>) {
+        (StartOne<I>(), ...);
+    }
+
+    template<size_t I>
+    static void StartOne() {
+        using Task = TaskAt<I>;
+        auto& tcb = tcbs_[I];
+        tcb.flags.staticSet = 1;
+#if PT_EXTEND_NEST_SUPPORT
+        pt* stack = nullptr;
+        if constexpr (Task::stackDepth_ != 0) {
+            stack = &stacks_[StackOffset(I)];
+        }
+        AddStaticTask(tcb, Task::name_, Task::code_, stack, Task::stackDepth_, userData_[I]);
+#else
+        AddStaticTask(tcb, Task::name_, Task::code_, userData_[I]);
+#endif
+    }
+
+    template<size_t... I>
+    static void RunAll(std::index_sequence<I...>) {
+        (RunOne<I>(), ...);
+    }
+
+    template<size_t I>
+    static void RunOne() {
+        auto& tcb = tcbs_[I];
+        if (!tcb.flags.ready) {
+            return;
+        }
+        SetCurrentTask(tcb);
+#if PT_EXTEND_TASK_STATS
+        uint64_t resumeBegin = TaskStatsNow();
+#endif
+        TaskAt<I>::code_(userData_[I]);
+#if PT_EXTEND_TASK_STATS
+        RecordTaskResume(tcb, TaskStatsNow() - resumeBegin);
+#endif
+    }
+
+    static inline PtExtend tcbs_[kTaskCount];
+    static inline void* userData_[kTaskCount];
+#if PT_EXTEND_NEST_SUPPORT
+    static inline pt stacks_[kStackDepth != 0 ? kStackDepth : 1];
+#endif
+};
+
+}
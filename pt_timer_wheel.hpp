@@ -0,0 +1,208 @@
+/*
+ * Hierarchical Timing Wheel
+ * 分层时间轮, 插入/删除/每tick到期均摊O(1)
+ * 1级256槽 + 10级64槽, 覆盖完整的64位tick范围, 节点记录绝对到期tick
+*/
+
+#pragma once
+#include <cstdint>
+
+namespace pt_extend {
+
+/* Node需要提供 wakeTick_ wheelSlot_ 以及kNext/kPrev指向的链接, 默认是 next_ prev_ */
+template<class Node, Node* Node::*kNext = &Node::next_, Node* Node::*kPrev = &Node::prev_>
+class TimerWheel {
+public:
+    static constexpr uint32_t kRootBits = 8;
+    static constexpr uint32_t kLevelBits = 6;
+    static constexpr uint32_t kLevels = 10;
+    static constexpr uint32_t kRootSize = 1u << kRootBits;
+    static constexpr uint32_t kLevelSize = 1u << kLevelBits;
+    static constexpr uint32_t kRootMask = kRootSize - 1;
+    static constexpr uint32_t kLevelMask = kLevelSize - 1;
+    static constexpr uint32_t kSlotCount = kRootSize + kLevels * kLevelSize;
+    static constexpr uint64_t kNoExpiry = UINT64_MAX;
+
+    /* ticks相对于已经处理过的最后一个tick, <=0视为下一个tick到期 */
+    void Add(Node* node, int64_t ticks) {
+        if (ticks < 1) {
+            ticks = 1;
+        }
+        node->wakeTick_ = nextTick_ + static_cast<uint64_t>(ticks) - 1;
+        Insert(node);
+        ++size_;
+    }
+
+    void Remove(Node* node) {
+        Unlink(slots_[node->wheelSlot_], node);
+        --size_;
+    }
+
+    /* 前进ticks, 每个到期节点调用一次onExpire */
+    template<class F>
+    void Advance(uint64_t ticks, F&& onExpire) {
+        /* 一次推进很多tick时(长时间睡眠/细粒度tick)直接跳到下一个到期或级联的tick,
+         * 跳过之后逐个处理kRootSize个tick再查找, 查找的开销分摊到每个tick */
+        uint32_t stepped = 0;
+        while (ticks != 0 && size_ != 0) {
+            if (ticks > kRootSize && stepped == 0) {
+                uint64_t skip = NextExpiry() - 1;
+                if (skip >= ticks) {
+                    break;
+                }
+                nextTick_ += skip;
+                ticks -= skip;
+                stepped = kRootSize;
+            }
+            if (stepped != 0) {
+                --stepped;
+            }
+            --ticks;
+            uint32_t index = nextTick_ & kRootMask;
+            if (index == 0) {
+                for (uint32_t level = 0; level < kLevels; level++) {
+                    uint32_t levelIndex = static_cast<uint32_t>(nextTick_ >> LevelShift(level)) & kLevelMask;
+                    Cascade(kRootSize + level * kLevelSize + levelIndex);
+                    if (levelIndex != 0) {
+                        break;
+                    }
+                }
+            }
+            ++nextTick_;
+
+            /* 先摘下整个槽, onExpire里重新加入的节点不会被本轮处理 */
+            Node* node = slots_[index].head_;
+            slots_[index] = {nullptr, nullptr};
+            while (node) {
+                auto* next = node->*kNext;
+                node->*kNext = nullptr;
+                node->*kPrev = nullptr;
+                --size_;
+                onExpire(node);
+                node = next;
+            }
+        }
+        nextTick_ += ticks;
+    }
+
+    /* 距离下一个到期还需要的tick数(下界, 来自高层级时可能提前), 空返回kNoExpiry */
+    uint64_t NextExpiry() const {
+        if (size_ == 0) {
+            return kNoExpiry;
+        }
+
+        uint64_t best = kNoExpiry;
+        for (uint32_t i = 0; i < kRootSize; i++) {
+            if (slots_[(nextTick_ + i) & kRootMask].head_) {
+                best = i;
+                break;
+            }
+        }
+
+        for (uint32_t level = 0; level < kLevels; level++) {
+            uint32_t shift = LevelShift(level);
+            uint64_t span = uint64_t{1} << shift;
+            uint64_t boundary = (nextTick_ + span - 1) & ~(span - 1);
+            uint32_t first = static_cast<uint32_t>(boundary >> shift) & kLevelMask;
+            const Slot* levelSlots = &slots_[kRootSize + level * kLevelSize];
+            for (uint32_t i = 0; i < kLevelSize; i++) {
+                if (levelSlots[(first + i) & kLevelMask].head_) {
+                    uint64_t offset = boundary + (uint64_t{i} << shift) - nextTick_;
+                    if (offset < best) {
+                        best = offset;
+                    }
+                    break;
+                }
+            }
+        }
+        return best + 1;
+    }
+
+    template<class F>
+    void ForEach(F&& f) const {
+        for (const auto& slot : slots_) {
+            for (auto* node = slot.head_; node; node = node->*kNext) {
+                f(node);
+            }
+        }
+    }
+
+    /* 已经处理过的tick数, Add(node, t - Now())在计数到达t时到期 */
+    uint64_t Now() const { return nextTick_; }
+
+    uint32_t Size() const { return size_; }
+    bool Empty() const { return size_ == 0; }
+
+private:
+    struct Slot {
+        Node* head_;
+        Node* tail_;
+    };
+
+    static constexpr uint32_t LevelShift(uint32_t level) {
+        return kRootBits + level * kLevelBits;
+    }
+
+    void Insert(Node* node) {
+        uint64_t expire = node->wakeTick_;
+        uint64_t delta = expire - nextTick_;
+        uint32_t slot;
+        if (static_cast<int64_t>(delta) < 0) {
+            slot = static_cast<uint32_t>(nextTick_) & kRootMask;
+        } else if (delta < kRootSize) {
+            slot = static_cast<uint32_t>(expire) & kRootMask;
+        } else {
+            uint32_t level = 0;
+            while (level + 1 < kLevels && (delta >> LevelShift(level + 1)) != 0) {
+                ++level;
+            }
+            slot = kRootSize + level * kLevelSize + (static_cast<uint32_t>(expire >> LevelShift(level)) & kLevelMask);
+        }
+        node->wheelSlot_ = static_cast<uint16_t>(slot);
+        Append(slots_[slot], node);
+    }
+
+    void Cascade(uint32_t slot) {
+        Node* node = slots_[slot].head_;
+        slots_[slot] = {nullptr, nullptr};
+        while (node) {
+            auto* next = node->*kNext;
+            Insert(node);
+            node = next;
+        }
+    }
+
+    static void Append(Slot& list, Node* node) {
+        node->*kPrev = list.tail_;
+        node->*kNext = nullptr;
+        if (list.tail_) {
+            list.tail_->*kNext = node;
+        } else {
+            list.head_ = node;
+        }
+        list.tail_ = node;
+    }
+
+    static void Unlink(Slot& list, Node* node) {
+        auto* prev = node->*kPrev;
+        auto* next = node->*kNext;
+        if (prev) {
+            prev->*kNext = next;
+        } else {
+            list.head_ = next;
+        }
+        if (next) {
+            next->*kPrev = prev;
+        } else {
+            list.tail_ = prev;
+        }
+        node->*kPrev = nullptr;
+        node->*kNext = nullptr;
+    }
+
+    Slot slots_[kSlotCount]{};
+    uint64_t nextTick_ = 0; /* 下一个待处理的tick */
+    uint32_t size_ = 0;
+};
+
+}
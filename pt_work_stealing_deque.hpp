@@ -0,0 +1,80 @@
+/*
+ * Chase-Lev Work Stealing Deque
+ * 所有者在bottom端Push/Take, 其他线程在top端Steal
+ * 固定容量, 满时Push返回false由调用者另行处理
+*/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+namespace pt_extend {
+
+template<class T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(uint32_t capacity)
+        : mask_(capacity - 1)
+        , buffer_(new std::atomic<T*>[capacity]) {
+    }
+
+    /* 仅所有者调用 */
+    bool Push(T* item) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        if (b - t > static_cast<int64_t>(mask_)) {
+            return false;
+        }
+        buffer_[b & mask_].store(item, std::memory_order_relaxed);
+        bottom_.store(b + 1, std::memory_order_release);
+        return true;
+    }
+
+    /* 仅所有者调用 */
+    T* Take() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T* item = buffer_[b & mask_].load(std::memory_order_relaxed);
+        if (t == b) {
+            if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom_.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    /* 任意线程调用, 竞争失败或为空返回nullptr */
+    T* Steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return nullptr;
+        }
+        T* item = buffer_[t & mask_].load(std::memory_order_relaxed);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        return item;
+    }
+
+    bool Empty() const {
+        return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+    }
+
+private:
+    alignas(64) std::atomic<int64_t> top_{0};
+    alignas(64) std::atomic<int64_t> bottom_{0};
+    uint32_t mask_;
+    std::unique_ptr<std::atomic<T*>[]> buffer_;
+};
+
+}